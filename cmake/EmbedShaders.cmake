@@ -0,0 +1,41 @@
+# wayfire_embed_shaders(target namespace shader1.glsl shader2.glsl ...)
+#
+# Generates <target>-shaders.hpp in the current binary directory, which
+# contains for each shader, for example vertex.glsl:
+#   <namespace>::vertex_glsl      - the source of the shader
+#   <namespace>::vertex_glsl_name - its path relative to the source tree,
+#                                   used to look it up in shader_override_dir
+#
+# wayfire_generate_shaders_header(header namespace shader1.glsl ...)
+#
+# Only adds the command generating the header, for other targets which
+# build sources including it, e.g wayfire-microbench
+
+set(WAYFIRE_EMBED_SHADERS_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/EmbedShadersScript.cmake)
+
+function(wayfire_generate_shaders_header header namespace)
+    set(shaders)
+    foreach(shader ${ARGN})
+        get_filename_component(shader ${shader} ABSOLUTE)
+        list(APPEND shaders ${shader})
+    endforeach(shader)
+
+    # semicolons would split the argument, so use another separator
+    string(REPLACE ";" "|" shader_list "${shaders}")
+
+    add_custom_command(OUTPUT ${header}
+        COMMAND ${CMAKE_COMMAND} -DOUTPUT=${header} -DNAMESPACE=${namespace}
+                -DROOT=${CMAKE_SOURCE_DIR} -DSHADERS=${shader_list}
+                -P ${WAYFIRE_EMBED_SHADERS_SCRIPT}
+        DEPENDS ${shaders} ${WAYFIRE_EMBED_SHADERS_SCRIPT}
+        COMMENT "Embedding shaders into ${header}"
+        VERBATIM)
+endfunction(wayfire_generate_shaders_header)
+
+function(wayfire_embed_shaders target namespace)
+    set(header ${CMAKE_CURRENT_BINARY_DIR}/${target}-shaders.hpp)
+    wayfire_generate_shaders_header(${header} ${namespace} ${ARGN})
+
+    target_sources(${target} PRIVATE ${header})
+    target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+endfunction(wayfire_embed_shaders)
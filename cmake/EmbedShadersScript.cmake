@@ -0,0 +1,21 @@
+# Called by wayfire_embed_shaders() in script mode, see EmbedShaders.cmake
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+string(TOUPPER "${NAMESPACE}_HPP" guard)
+
+set(content "/* generated by cmake/EmbedShadersScript.cmake, do not edit */\n")
+set(content "${content}#ifndef ${guard}\n#define ${guard}\n\nnamespace ${NAMESPACE}\n{\n")
+
+foreach(shader ${SHADERS})
+    get_filename_component(filename ${shader} NAME)
+    string(MAKE_C_IDENTIFIER ${filename} var)
+    file(RELATIVE_PATH name ${ROOT} ${shader})
+    file(READ ${shader} source)
+
+    set(content "${content}    static const char ${var}_name[] = \"${name}\";\n")
+    set(content "${content}    static const char ${var}[] = R\"wfshader(${source})wfshader\";\n\n")
+endforeach(shader)
+
+set(content "${content}}\n\n#endif /* end of include guard: ${guard} */\n")
+
+file(WRITE ${OUTPUT} "${content}")
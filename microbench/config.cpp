@@ -0,0 +1,219 @@
+#include "microbench.hpp"
+
+#include <config.hpp>
+#include <memory>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace microbench
+{
+    /* a configuration of the size of a usual wayfire.ini */
+    static const char *config_text =
+        "[core]\n"
+        "vwidth = 3\n"
+        "vheight = 3\n"
+        "plugins = viewport_impl move resize animate switcher vswitch cube expo grid tile\n"
+        "background = /usr/share/backgrounds/default.png\n"
+        "shadersrc = /usr/share/wayfire/shaders\n"
+        "\n"
+        "[input]\n"
+        "xkb_layout = us,de\n"
+        "xkb_options = grp:alt_shift_toggle\n"
+        "kb_repeat_rate = 40\n"
+        "kb_repeat_delay = 400\n"
+        "\n"
+        "[move]\n"
+        "activate = <super> left\n"
+        "\n"
+        "[resize]\n"
+        "activate = <super> right\n"
+        "\n"
+        "[animate]\n"
+        "open_animation = fade\n"
+        "close_animation = fade\n"
+        "duration = 300\n"
+        "\n"
+        "[switcher]\n"
+        "activate = <super> KEY_TAB\n"
+        "duration = 200\n"
+        "\n"
+        "[vswitch]\n"
+        "binding_left = <ctrl> <alt> KEY_LEFT\n"
+        "binding_right = <ctrl> <alt> KEY_RIGHT\n"
+        "binding_up = <ctrl> <alt> KEY_UP\n"
+        "binding_down = <ctrl> <alt> KEY_DOWN\n"
+        "duration = 180\n"
+        "\n"
+        "[cube]\n"
+        "activate = <ctrl> <alt> left\n"
+        "background = 0.1 0.1 0.1 1\n"
+        "deform = 0\n"
+        "\n"
+        "[expo]\n"
+        "toggle = <super> KEY_E\n"
+        "\n"
+        "[grid]\n"
+        "duration = 300\n"
+        "\n"
+        "[tile]\n"
+        "toggle_tile = <super> KEY_T\n"
+        "toggle_fullscreen = <super> KEY_F\n"
+        "action_rotate = KEY_R\n"
+        "action_child = KEY_C\n"
+        "action_exit = KEY_ENTER\n"
+        "\n"
+        "[command]\n"
+        "binding_terminal = <super> KEY_ENTER\n"
+        "command_terminal = weston-terminal\n"
+        "binding_launcher = <super> KEY_R\n"
+        "command_launcher = wofi --show run\n"
+        "\n"
+        "[autostart]\n"
+        "panel = wayfire-shell-panel\n"
+        "background = wayfire-shell-background\n";
+
+    static const char *section_names[] = {
+        "core", "input", "move", "resize", "animate", "switcher", "vswitch",
+        "cube", "expo", "grid", "tile", "command", "autostart",
+    };
+
+    /* wayfire_config doesn't free its sections, the benchmarks only
+     * look up sections which are in the file */
+    static void delete_config(wayfire_config *config)
+    {
+        std::vector<wayfire_config_section*> sections;
+        for (auto name : section_names)
+            sections.push_back(config->get_section(name));
+
+        for (auto section : sections)
+            delete section;
+        delete config;
+    }
+
+    /* the config file, removed when the benchmarks are done with it */
+    struct temp_config
+    {
+        std::string path;
+
+        temp_config()
+        {
+            const char *dir = std::getenv("TMPDIR");
+            path = std::string(dir ? dir : "/tmp") +
+                "/wayfire-microbench-" + std::to_string(getpid()) + ".ini";
+
+            std::ofstream out(path);
+            out << config_text;
+        }
+
+        ~temp_config()
+        {
+            unlink(path.c_str());
+        }
+    };
+
+    void add_config_benchmarks()
+    {
+        add("config/parse", [] ()
+        {
+            auto file = std::make_shared<temp_config>();
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    delete_config(new wayfire_config(file->path));
+            };
+        });
+
+        /* shared by the lookup benchmarks, the config is parsed once */
+        auto config = std::make_shared<wayfire_config*>(nullptr);
+        auto get_config = [=] ()
+        {
+            if (!*config)
+            {
+                temp_config file;
+                *config = new wayfire_config(file.path);
+            }
+
+            return *config;
+        };
+
+        add("config/get_section", [=] ()
+        {
+            auto cfg = get_config();
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(cfg->get_section("autostart"));
+            };
+        });
+
+        add("config/get_int", [=] ()
+        {
+            auto section = get_config()->get_section("vswitch");
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(section->get_int("duration", 0));
+            };
+        });
+
+        add("config/get_string", [=] ()
+        {
+            auto section = get_config()->get_section("core");
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(section->get_string("background", "").size());
+            };
+        });
+
+        add("config/get_key", [=] ()
+        {
+            auto section = get_config()->get_section("vswitch");
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(section->get_key("binding_left", {0, 0}).keyval);
+            };
+        });
+
+        add("config/get_button", [=] ()
+        {
+            auto section = get_config()->get_section("cube");
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(section->get_button("activate", {0, 0}).button);
+            };
+        });
+
+        add("config/get_color", [=] ()
+        {
+            auto section = get_config()->get_section("cube");
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(section->get_color("background", {0, 0, 0, 0}).r);
+            };
+        });
+
+        /* what a plugin's init() reads */
+        add("config/plugin_init", [=] ()
+        {
+            auto cfg = get_config();
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    auto section = cfg->get_section("tile");
+                    keep(section->get_key("toggle_tile", {0, 0}).keyval);
+                    keep(section->get_key("toggle_fullscreen", {0, 0}).keyval);
+                    keep(section->get_key("action_rotate", {0, 0}).keyval);
+                    keep(section->get_key("action_child", {0, 0}).keyval);
+                    keep(section->get_key("action_exit", {0, 0}).keyval);
+                    keep(section->get_int("duration", 300));
+                }
+            };
+        });
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef FAKE_COMPOSITOR_H
+#define FAKE_COMPOSITOR_H
+
+/* A lightweight fake of libweston-3: only the structures and fields which
+ * wayfire's headers and the sources built into wayfire-microbench use,
+ * laid out however is convenient. The functions are stubbed in
+ * microbench/stubs.cpp, and do just enough for the benchmarks */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pixman.h>
+#include <wayland-server.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct weston_compositor;
+struct weston_output;
+struct weston_view;
+struct weston_surface;
+struct weston_seat;
+struct weston_keyboard;
+struct weston_pointer;
+struct weston_touch;
+struct weston_binding;
+struct weston_pointer_axis_event;
+struct weston_pointer_motion_event;
+
+struct weston_geometry
+{
+    int32_t x, y;
+    int32_t width, height;
+};
+
+enum weston_keyboard_modifier
+{
+    MODIFIER_CTRL  = (1 << 0),
+    MODIFIER_ALT   = (1 << 1),
+    MODIFIER_SUPER = (1 << 2),
+    MODIFIER_SHIFT = (1 << 3),
+};
+
+enum weston_compositor_backend
+{
+    WESTON_BACKEND_DRM,
+    WESTON_BACKEND_FBDEV,
+    WESTON_BACKEND_HEADLESS,
+    WESTON_BACKEND_RDP,
+    WESTON_BACKEND_WAYLAND,
+    WESTON_BACKEND_X11,
+};
+
+enum weston_layer_position
+{
+    WESTON_LAYER_POSITION_HIDDEN     = 0x00000000,
+    WESTON_LAYER_POSITION_BACKGROUND = 0x00000002,
+    WESTON_LAYER_POSITION_BOTTOM_UI  = 0x30000000,
+    WESTON_LAYER_POSITION_NORMAL     = 0x50000000,
+    WESTON_LAYER_POSITION_UI         = 0x80000000,
+    WESTON_LAYER_POSITION_FULLSCREEN = 0xb0000000,
+    WESTON_LAYER_POSITION_TOP_UI     = 0xe0000000,
+    WESTON_LAYER_POSITION_LOCK       = 0xffff0000,
+    WESTON_LAYER_POSITION_CURSOR     = 0xfffffffe,
+    WESTON_LAYER_POSITION_FADE       = 0xffffffff,
+};
+
+struct weston_layer;
+
+struct weston_layer_entry
+{
+    struct wl_list link;
+    struct weston_layer *layer;
+};
+
+struct weston_layer
+{
+    struct weston_compositor *compositor;
+    struct wl_list link;
+    enum weston_layer_position position;
+    struct weston_layer_entry view_list;
+};
+
+struct weston_compositor
+{
+    struct wl_display *wl_display;
+};
+
+struct weston_animation
+{
+    void (*frame)(struct weston_animation *animation,
+            struct weston_output *output, const struct timespec *time);
+    int frame_counter;
+    struct wl_list link;
+};
+
+struct weston_output
+{
+    uint32_t id;
+    int32_t x, y, width, height;
+    pixman_region32_t region;
+    struct wl_list animation_list;
+    struct timespec frame_time;
+};
+
+struct weston_surface
+{
+    int32_t width, height;
+    bool is_mapped;
+    void *renderer_state;
+    struct wl_list subsurface_list;
+};
+
+struct weston_subsurface
+{
+    struct weston_surface *surface;
+    struct wl_list parent_link;
+    struct {
+        int32_t x, y;
+    } position;
+};
+
+struct weston_view
+{
+    struct weston_surface *surface;
+    struct weston_layer_entry layer_link;
+    bool is_mapped;
+    pixman_region32_t damage_clip_region;
+
+    struct {
+        /* the opaque part of the view, in global coordinates */
+        pixman_region32_t opaque;
+    } transform;
+};
+
+struct weston_seat
+{
+    uint32_t modifier_state;
+};
+
+struct weston_keyboard_grab
+{
+    const void *interface;
+    struct weston_keyboard *keyboard;
+};
+
+struct weston_pointer_grab
+{
+    const void *interface;
+    struct weston_pointer *pointer;
+};
+
+struct weston_touch_grab
+{
+    const void *interface;
+    struct weston_touch *touch;
+};
+
+void weston_layer_init(struct weston_layer *layer, struct weston_compositor *compositor);
+void weston_layer_set_position(struct weston_layer *layer, enum weston_layer_position position);
+void weston_layer_unset_position(struct weston_layer *layer);
+void weston_layer_entry_insert(struct weston_layer_entry *list, struct weston_layer_entry *entry);
+void weston_layer_entry_remove(struct weston_layer_entry *entry);
+
+void weston_view_set_position(struct weston_view *view, float x, float y);
+void weston_view_update_transform(struct weston_view *view);
+bool weston_surface_is_mapped(struct weston_surface *surface);
+
+void weston_output_schedule_repaint(struct weston_output *output);
+void weston_output_damage(struct weston_output *output);
+
+void weston_touch_send_down(struct weston_touch *touch, uint32_t time,
+        int touch_id, wl_fixed_t x, wl_fixed_t y);
+void weston_touch_send_up(struct weston_touch *touch, uint32_t time, int touch_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_COMPOSITOR_H */
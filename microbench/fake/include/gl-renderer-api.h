@@ -0,0 +1,19 @@
+#ifndef FAKE_GL_RENDERER_API_H
+#define FAKE_GL_RENDERER_API_H
+
+#include <compositor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct weston_gl_renderer_api
+{
+    void *(*surface_get_textures)(struct weston_surface *surface, int *n_textures);
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_GL_RENDERER_API_H */
@@ -0,0 +1,15 @@
+#ifndef FAKE_LIBEVDEV_H
+#define FAKE_LIBEVDEV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* knows the key and button names of the benchmark configs, see stubs.cpp */
+int libevdev_event_code_from_name(unsigned int type, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_LIBEVDEV_H */
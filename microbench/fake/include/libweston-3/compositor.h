@@ -0,0 +1 @@
+#include "../compositor.h"
@@ -0,0 +1,38 @@
+#ifndef FAKE_LIBWESTON_DESKTOP_H
+#define FAKE_LIBWESTON_DESKTOP_H
+
+/* libweston-desktop keeps the desktop surface opaque, the fake shows it
+ * so that the benchmarks can create views without a client */
+
+#include <compositor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct weston_desktop_surface
+{
+    struct weston_surface *surface;
+    struct weston_geometry geometry;
+    bool maximized, fullscreen;
+    void *user_data;
+};
+
+struct weston_view *weston_desktop_surface_create_view(struct weston_desktop_surface *surface);
+struct weston_surface *weston_desktop_surface_get_surface(struct weston_desktop_surface *surface);
+struct weston_geometry weston_desktop_surface_get_geometry(struct weston_desktop_surface *surface);
+
+void weston_desktop_surface_set_user_data(struct weston_desktop_surface *surface, void *user_data);
+void weston_desktop_surface_set_activated(struct weston_desktop_surface *surface, bool activated);
+void weston_desktop_surface_set_size(struct weston_desktop_surface *surface,
+        int32_t width, int32_t height);
+void weston_desktop_surface_set_maximized(struct weston_desktop_surface *surface, bool maximized);
+void weston_desktop_surface_set_fullscreen(struct weston_desktop_surface *surface, bool fullscreen);
+bool weston_desktop_surface_get_maximized(struct weston_desktop_surface *surface);
+bool weston_desktop_surface_get_fullscreen(struct weston_desktop_surface *surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_LIBWESTON_DESKTOP_H */
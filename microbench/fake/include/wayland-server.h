@@ -0,0 +1,136 @@
+#ifndef FAKE_WAYLAND_SERVER_H
+#define FAKE_WAYLAND_SERVER_H
+
+/* The parts of libwayland-server which wayfire's headers and the sources
+ * built into wayfire-microbench use. Lists work like the real ones, the
+ * functions which aren't inline are stubbed in microbench/stubs.cpp */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct wl_client;
+struct wl_display;
+struct wl_event_loop;
+struct wl_event_source;
+struct wl_resource;
+
+struct wl_interface
+{
+    const char *name;
+    int version;
+};
+
+struct wl_array
+{
+    size_t size, alloc;
+    void *data;
+};
+
+struct wl_list
+{
+    struct wl_list *prev, *next;
+};
+
+static inline void wl_list_init(struct wl_list *list)
+{
+    list->prev = list->next = list;
+}
+
+static inline void wl_list_insert(struct wl_list *list, struct wl_list *elm)
+{
+    elm->prev = list;
+    elm->next = list->next;
+    list->next = elm;
+    elm->next->prev = elm;
+}
+
+static inline void wl_list_remove(struct wl_list *elm)
+{
+    elm->prev->next = elm->next;
+    elm->next->prev = elm->prev;
+    elm->next = elm->prev = NULL;
+}
+
+static inline int wl_list_empty(const struct wl_list *list)
+{
+    return list->next == list;
+}
+
+#define wl_container_of(ptr, sample, member) \
+    (__typeof__(sample))((char *)(ptr) - offsetof(__typeof__(*sample), member))
+
+#define wl_list_for_each(pos, head, member) \
+    for (pos = wl_container_of((head)->next, pos, member); \
+         &pos->member != (head); \
+         pos = wl_container_of(pos->member.next, pos, member))
+
+#define wl_list_for_each_reverse(pos, head, member) \
+    for (pos = wl_container_of((head)->prev, pos, member); \
+         &pos->member != (head); \
+         pos = wl_container_of(pos->member.prev, pos, member))
+
+struct wl_listener;
+typedef void (*wl_notify_func_t)(struct wl_listener *listener, void *data);
+
+struct wl_listener
+{
+    struct wl_list link;
+    wl_notify_func_t notify;
+};
+
+struct wl_signal
+{
+    struct wl_list listener_list;
+};
+
+typedef int32_t wl_fixed_t;
+
+static inline double wl_fixed_to_double(wl_fixed_t f)
+{
+    return f / 256.0;
+}
+
+static inline wl_fixed_t wl_fixed_from_double(double d)
+{
+    return (wl_fixed_t)(d * 256.0);
+}
+
+static inline int wl_fixed_to_int(wl_fixed_t f)
+{
+    return f / 256;
+}
+
+static inline wl_fixed_t wl_fixed_from_int(int i)
+{
+    return i * 256;
+}
+
+enum wl_output_transform
+{
+    WL_OUTPUT_TRANSFORM_NORMAL = 0,
+    WL_OUTPUT_TRANSFORM_90 = 1,
+    WL_OUTPUT_TRANSFORM_180 = 2,
+    WL_OUTPUT_TRANSFORM_270 = 3,
+    WL_OUTPUT_TRANSFORM_FLIPPED = 4,
+    WL_OUTPUT_TRANSFORM_FLIPPED_90 = 5,
+    WL_OUTPUT_TRANSFORM_FLIPPED_180 = 6,
+    WL_OUTPUT_TRANSFORM_FLIPPED_270 = 7
+};
+
+typedef void (*wl_event_loop_idle_func_t)(void *data);
+
+struct wl_event_loop *wl_display_get_event_loop(struct wl_display *display);
+struct wl_event_source *wl_event_loop_add_idle(struct wl_event_loop *loop,
+        wl_event_loop_idle_func_t func, void *data);
+
+void wl_resource_post_event(struct wl_resource *resource, uint32_t opcode, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_WAYLAND_SERVER_H */
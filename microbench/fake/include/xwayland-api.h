@@ -0,0 +1,24 @@
+#ifndef FAKE_XWAYLAND_API_H
+#define FAKE_XWAYLAND_API_H
+
+#include <compositor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct weston_xwayland_surface_api
+{
+    bool (*is_xwayland_surface)(struct weston_surface *surface);
+    void (*send_position)(struct weston_surface *surface, int32_t x, int32_t y);
+};
+
+/* there is no xwayland in the benchmarks, so the stub returns null */
+const struct weston_xwayland_surface_api *
+weston_xwayland_surface_get_api(struct weston_compositor *compositor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_XWAYLAND_API_H */
@@ -0,0 +1,28 @@
+#ifndef FAKE_WAYFIRE_SHELL_SERVER_H
+#define FAKE_WAYFIRE_SHELL_SERVER_H
+
+/* output.hpp includes the generated header as "../proto/wayfire-shell-server.h",
+ * which resolves here from fake/include when it hasn't been generated in the
+ * source tree. Only the types used by the headers are declared */
+
+#include <wayland-server.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum wayfire_shell_panel_position
+{
+    WAYFIRE_SHELL_PANEL_POSITION_LEFT = 1,
+    WAYFIRE_SHELL_PANEL_POSITION_RIGHT = 2,
+    WAYFIRE_SHELL_PANEL_POSITION_UP = 3,
+    WAYFIRE_SHELL_PANEL_POSITION_DOWN = 4,
+};
+
+struct wayfire_shell_interface;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: FAKE_WAYFIRE_SHELL_SERVER_H */
@@ -0,0 +1,76 @@
+#include "microbench.hpp"
+#include "stubs.hpp"
+
+#include <gesture-recognizer.hpp>
+
+namespace microbench
+{
+    static int gestures_emitted = 0;
+
+    static std::shared_ptr<wf_gesture_recognizer> make_recognizer()
+    {
+        /* the recognizer checks the bindings in core->input */
+        get_output();
+
+        return std::make_shared<wf_gesture_recognizer> (nullptr,
+                [] (wayfire_touch_gesture gesture) { ++gestures_emitted; });
+    }
+
+    static int finger_x(int id)
+    {
+        return 400 + 200 * id;
+    }
+
+    void add_gesture_benchmarks()
+    {
+        for (int fingers : {3, 5})
+        {
+            /* the fingers of a gesture jitter, but not far enough to swipe or pinch,
+             * so that each motion event goes through all the checks */
+            add("gesture/update/" + std::to_string(fingers), [=] ()
+            {
+                auto recognizer = make_recognizer();
+                for (int i = 0; i < fingers; i++)
+                    recognizer->register_touch(i, finger_x(i), 500);
+
+                return [=] (uint64_t iterations)
+                {
+                    for (uint64_t i = 0; i < iterations; i++)
+                    {
+                        int id = i % fingers;
+                        int offset = (i / fingers) & 1 ? 20 : 0;
+                        recognizer->update_touch(id, finger_x(id) + offset, 500 + offset);
+                    }
+
+                    keep(recognizer->gesture_emitted);
+                };
+            }, EXPECT_NO_ALLOCATIONS);
+        }
+
+        /* a whole three finger swipe: the fingers touch down, move right
+         * until the swipe is recognized and are lifted */
+        add("gesture/swipe/3", [] ()
+        {
+            auto recognizer = make_recognizer();
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    for (int id = 0; id < 3; id++)
+                        recognizer->register_touch(id, finger_x(id), 500);
+
+                    for (int step = 1; step <= 4; step++)
+                    {
+                        for (int id = 0; id < 3; id++)
+                            recognizer->update_touch(id, finger_x(id) + 40 * step, 500);
+                    }
+
+                    for (int id = 0; id < 3; id++)
+                        recognizer->unregister_touch(id);
+                }
+
+                keep(gestures_emitted);
+            };
+        });
+    }
+}
@@ -0,0 +1,188 @@
+#include "stubs.hpp"
+
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+
+/* libGLESv2 for the real opengl.cpp. Every call is counted and does as little
+ * as possible: objects get new names, compiles and links succeed, there are
+ * no program binary formats (so no disk cache) and no errors. The stubs are
+ * in their own file so that the compiler can't inline them into the renderer */
+namespace microbench
+{
+    uint64_t gl_calls = 0;
+}
+
+namespace
+{
+    GLuint last_name = 0;
+
+    void gen_names(GLsizei n, GLuint *names)
+    {
+        ++microbench::gl_calls;
+        for (GLsizei i = 0; i < n; i++)
+            names[i] = ++last_name;
+    }
+
+    /* big enough for the whole quad ring of a context */
+    char mapped_buffer[1 << 21];
+}
+
+#define COUNT ++microbench::gl_calls
+
+extern "C"
+{
+    /* objects */
+    void glGenBuffers(GLsizei n, GLuint *buffers) { gen_names(n, buffers); }
+    void glGenFramebuffers(GLsizei n, GLuint *fbs) { gen_names(n, fbs); }
+    void glGenSamplers(GLsizei n, GLuint *samplers) { gen_names(n, samplers); }
+    void glGenTextures(GLsizei n, GLuint *textures) { gen_names(n, textures); }
+    void glGenVertexArrays(GLsizei n, GLuint *arrays) { gen_names(n, arrays); }
+
+    void glDeleteBuffers(GLsizei n, const GLuint *buffers) { COUNT; }
+    void glDeleteFramebuffers(GLsizei n, const GLuint *fbs) { COUNT; }
+    void glDeleteSamplers(GLsizei n, const GLuint *samplers) { COUNT; }
+    void glDeleteTextures(GLsizei n, const GLuint *textures) { COUNT; }
+    void glDeleteVertexArrays(GLsizei n, const GLuint *arrays) { COUNT; }
+
+    /* shaders and programs */
+    GLuint glCreateShader(GLenum type) { COUNT; return ++last_name; }
+    GLuint glCreateProgram() { COUNT; return ++last_name; }
+    void glDeleteShader(GLuint shader) { COUNT; }
+    void glDeleteProgram(GLuint program) { COUNT; }
+
+    void glShaderSource(GLuint shader, GLsizei count,
+            const GLchar *const *string, const GLint *length) { COUNT; }
+    void glCompileShader(GLuint shader) { COUNT; }
+    void glAttachShader(GLuint program, GLuint shader) { COUNT; }
+    void glDetachShader(GLuint program, GLuint shader) { COUNT; }
+    void glLinkProgram(GLuint program) { COUNT; }
+    void glProgramParameteri(GLuint program, GLenum pname, GLint value) { COUNT; }
+    void glProgramBinary(GLuint program, GLenum format,
+            const void *binary, GLsizei length) { COUNT; }
+
+    void glGetShaderiv(GLuint shader, GLenum pname, GLint *params)
+    {
+        COUNT;
+        *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+    }
+
+    void glGetProgramiv(GLuint program, GLenum pname, GLint *params)
+    {
+        COUNT;
+        *params = (pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+    }
+
+    void glGetShaderInfoLog(GLuint shader, GLsizei size, GLsizei *length, GLchar *log)
+    {
+        COUNT;
+        if (length)
+            *length = 0;
+        if (size > 0)
+            log[0] = 0;
+    }
+
+    void glGetProgramInfoLog(GLuint program, GLsizei size, GLsizei *length, GLchar *log)
+    {
+        glGetShaderInfoLog(program, size, length, log);
+    }
+
+    void glGetProgramBinary(GLuint program, GLsizei size, GLsizei *length,
+            GLenum *format, void *binary)
+    {
+        COUNT;
+        if (length)
+            *length = 0;
+    }
+
+    /* the uniforms and attributes in the order they are queried */
+    GLint glGetUniformLocation(GLuint program, const GLchar *name) { COUNT; return 1; }
+    GLint glGetAttribLocation(GLuint program, const GLchar *name) { COUNT; return 0; }
+
+    void glUseProgram(GLuint program) { COUNT; }
+    void glUniform1f(GLint location, GLfloat v0) { COUNT; }
+    void glUniform4fv(GLint location, GLsizei count, const GLfloat *value) { COUNT; }
+    void glUniformMatrix4fv(GLint location, GLsizei count,
+            GLboolean transpose, const GLfloat *value) { COUNT; }
+
+    /* state */
+    void glEnable(GLenum cap) { COUNT; }
+    void glDisable(GLenum cap) { COUNT; }
+    void glBlendFunc(GLenum sfactor, GLenum dfactor) { COUNT; }
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { COUNT; }
+    void glClear(GLbitfield mask) { COUNT; }
+
+    void glGetIntegerv(GLenum pname, GLint *data)
+    {
+        COUNT;
+        *data = 0;
+    }
+
+    const GLubyte *glGetString(GLenum name)
+    {
+        COUNT;
+        return nullptr;
+    }
+
+    GLenum glGetError()
+    {
+        COUNT;
+        return GL_NO_ERROR;
+    }
+
+    /* textures and framebuffers */
+    void glActiveTexture(GLenum texture) { COUNT; }
+    void glBindTexture(GLenum target, GLuint texture) { COUNT; }
+    void glBindSampler(GLuint unit, GLuint sampler) { COUNT; }
+    void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param) { COUNT; }
+    void glTexParameteri(GLenum target, GLenum pname, GLint param) { COUNT; }
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat,
+            GLsizei width, GLsizei height, GLint border, GLenum format,
+            GLenum type, const void *pixels) { COUNT; }
+
+    void glBindFramebuffer(GLenum target, GLuint framebuffer) { COUNT; }
+    void glFramebufferTexture2D(GLenum target, GLenum attachment,
+            GLenum textarget, GLuint texture, GLint level) { COUNT; }
+    void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+            GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+            GLbitfield mask, GLenum filter) { COUNT; }
+
+    GLenum glCheckFramebufferStatus(GLenum target)
+    {
+        COUNT;
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    /* vertex data */
+    void glBindVertexArray(GLuint array) { COUNT; }
+    void glBindBuffer(GLenum target, GLuint buffer) { COUNT; }
+    void glBufferData(GLenum target, GLsizeiptr size,
+            const void *data, GLenum usage) { COUNT; }
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type,
+            GLboolean normalized, GLsizei stride, const void *pointer) { COUNT; }
+    void glEnableVertexAttribArray(GLuint index) { COUNT; }
+
+    void *glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
+            GLbitfield access)
+    {
+        COUNT;
+        if (length > (GLsizeiptr)sizeof(mapped_buffer))
+            return nullptr;
+
+        return mapped_buffer;
+    }
+
+    GLboolean glUnmapBuffer(GLenum target)
+    {
+        COUNT;
+        return GL_TRUE;
+    }
+
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type,
+            const void *indices) { COUNT; }
+
+    /* for enable_debug_output() in debug builds, GL_KHR_debug isn't supported */
+    __eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *procname)
+    {
+        return nullptr;
+    }
+}
@@ -0,0 +1,245 @@
+#include "microbench.hpp"
+
+#include <new>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+/* Count the heap allocations by wrapping glibc's allocator, so that those
+ * of C libraries(pixman) are seen too. operator new is replaced to count
+ * wayfire's own allocations separately. The benchmarks are single threaded,
+ * so the counters needn't be atomic */
+static uint64_t allocation_count = 0, new_count = 0;
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+
+    void *malloc(size_t size)
+    {
+        ++allocation_count;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        ++allocation_count;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        ++allocation_count;
+        return __libc_realloc(ptr, size);
+    }
+}
+
+void *operator new(size_t size)
+{
+    ++new_count;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    ++new_count;
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+namespace microbench
+{
+    struct benchmark
+    {
+        std::string name;
+        setup_t setup;
+        uint32_t flags;
+    };
+
+    static std::vector<benchmark>& get_benchmarks()
+    {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    void add(std::string name, setup_t setup, uint32_t flags)
+    {
+        get_benchmarks().push_back({name, setup, flags});
+    }
+
+    uint64_t allocations()
+    {
+        return allocation_count;
+    }
+
+    uint64_t new_allocations()
+    {
+        return new_count;
+    }
+
+    static double run_ns(const run_t& run, uint64_t iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run(iterations);
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    struct result
+    {
+        double ns_per_op;
+        double allocations_per_op, new_per_op;
+    };
+
+    /* the calibration doubles as the warm up, so that caches
+     * and scratch containers are in their steady state */
+    static result measure(const benchmark& bench, double min_time_ns, int repetitions)
+    {
+        auto run = bench.setup();
+
+        uint64_t iterations = 1;
+        double elapsed;
+        while ((elapsed = run_ns(run, iterations)) < min_time_ns / 10 &&
+                iterations < (1ull << 40))
+        {
+            iterations *= 2;
+        }
+
+        iterations = std::max<uint64_t>(1, iterations * min_time_ns / std::max(elapsed, 1.0));
+
+        /* reserved, so that only the benchmark allocates while counting */
+        std::vector<double> times;
+        times.reserve(repetitions);
+
+        uint64_t allocations_before = allocations(), new_before = new_allocations();
+        for (int i = 0; i < repetitions; i++)
+            times.push_back(run_ns(run, iterations) / iterations);
+
+        double ops = 1.0 * iterations * repetitions;
+        result r;
+        r.allocations_per_op = (allocations() - allocations_before) / ops;
+        r.new_per_op = (new_allocations() - new_before) / ops;
+
+        std::sort(times.begin(), times.end());
+        r.ns_per_op = times[times.size() / 2];
+        return r;
+    }
+
+    static bool matches(const std::string& name, const std::vector<std::string>& filters)
+    {
+        if (filters.empty())
+            return true;
+
+        for (auto& filter : filters)
+        {
+            if (name.find(filter) != std::string::npos)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+static void usage(const char *name)
+{
+    std::printf("usage: %s [--min-time <ms>] [--repetitions <n>] [--list] [filter...]\n\n"
+            "Runs the benchmarks whose names contain one of the filters, or all.\n"
+            "Steady-state benchmarks fail if wayfire allocates memory in them\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    double min_time_ms = 200;
+    int repetitions = 5;
+    bool list = false;
+    std::vector<std::string> filters;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+            min_time_ms = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--repetitions") && i + 1 < argc)
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--list"))
+            list = true;
+        else if (argv[i][0] == '-')
+            return usage(argv[0]), 1;
+        else
+            filters.push_back(argv[i]);
+    }
+
+    microbench::add_signal_benchmarks();
+    microbench::add_config_benchmarks();
+    microbench::add_tile_benchmarks();
+    microbench::add_gesture_benchmarks();
+    microbench::add_workspace_benchmarks();
+    microbench::add_render_benchmarks();
+
+    if (!list)
+        std::printf("%-48s %14s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "new/op");
+
+    int failed = 0;
+    for (auto& bench : microbench::get_benchmarks())
+    {
+        if (!microbench::matches(bench.name, filters))
+            continue;
+
+        if (list)
+        {
+            std::printf("%s\n", bench.name.c_str());
+            continue;
+        }
+
+        auto result = microbench::measure(bench, min_time_ms * 1e6, repetitions);
+        std::printf("%-48s %14.1f %12.2f %12.2f\n", bench.name.c_str(),
+                result.ns_per_op, result.allocations_per_op, result.new_per_op);
+        std::fflush(stdout);
+
+        if ((bench.flags & microbench::EXPECT_NO_ALLOCATIONS) &&
+                result.new_per_op > 0)
+        {
+            std::printf("FAIL: %s allocates in the steady state\n", bench.name.c_str());
+            ++failed;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+#ifndef MICROBENCH_HPP
+#define MICROBENCH_HPP
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+/* A minimal benchmark harness. A benchmark is a setup function, which
+ * returns the function running the operation the given number of times.
+ * The harness calls the setup right before measuring, calibrates the count
+ * so that a run takes at least the minimum time, repeats the run and reports
+ * the median time and the heap allocations per operation */
+namespace microbench
+{
+    using run_t = std::function<void(uint64_t iterations)>;
+    using setup_t = std::function<run_t()>;
+
+    /* for steady-state benchmarks, in which wayfire must not allocate, i.e
+     * call operator new. pixman may still reallocate the data of regions
+     * whose shape changes. wayfire-microbench fails if the check fails */
+    const uint32_t EXPECT_NO_ALLOCATIONS = 1 << 0;
+
+    void add(std::string name, setup_t setup, uint32_t flags = 0);
+
+    /* heap allocations since the start of the program: all of them, and
+     * those made through operator new, which are a part of all */
+    uint64_t allocations();
+    uint64_t new_allocations();
+
+    /* keeps the compiler from optimizing the computation of value away */
+    template<class T> inline void keep(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /* each file registers its benchmarks here */
+    void add_signal_benchmarks();
+    void add_config_benchmarks();
+    void add_tile_benchmarks();
+    void add_gesture_benchmarks();
+    void add_workspace_benchmarks();
+    void add_render_benchmarks();
+}
+
+#endif /* end of include guard: MICROBENCH_HPP */
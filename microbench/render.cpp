@@ -0,0 +1,182 @@
+#include "microbench.hpp"
+#include "stubs.hpp"
+
+#include <opengl.hpp>
+#include <gl-renderer-api.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+/* The real renderer in view-damage.cpp and opengl.cpp, on top of the stub GL
+ * in gl.cpp. So these measure only the CPU side of a frame, how long it takes
+ * a real driver to execute the GL calls is up to wayfire-bench */
+struct render_benchmark_access
+{
+    /* the damage of the stream of workspace ws, like in workspace_stream_update().
+     * Returns how many views would be rendered */
+    static size_t collect_stream_damage(wayfire_output *output,
+            std::tuple<int, int> ws, pixman_region32_t *frame_damage)
+    {
+        auto render = output->render;
+        auto g = output->get_full_geometry();
+
+        GetTuple(x, y, ws);
+        GetTuple(cx, cy, output->workspace->get_current_workspace());
+
+        int dx = g.x + (x - cx) * g.width,
+            dy = g.y + (y - cy) * g.height;
+
+        auto& ws_damage = render->frame_scratch.ws_damage;
+        pixman_region32_intersect_rect(&ws_damage, frame_damage, dx, dy, g.width, g.height);
+        render->collect_damaged_views(ws, &ws_damage, dx, dy);
+
+        size_t count = render->frame_scratch.damaged_views_count;
+        render->frame_scratch.damaged_views_count = 0;
+        return count;
+    }
+};
+
+namespace microbench
+{
+    /* one texture for each surface, like a client with a RGBA buffer */
+    static void *get_textures(weston_surface *surface, int *n_textures)
+    {
+        static GLuint texture = 1;
+
+        *n_textures = 1;
+        return &texture;
+    }
+
+    static const weston_gl_renderer_api renderer_api = {get_textures};
+
+    /* the output gets a GL context the first time, like in load_context(),
+     * and the whole output is repainted */
+    static wayfire_output *setup_frame(size_t view_count)
+    {
+        auto output = get_output();
+        if (!output->render->ctx)
+        {
+            render_manager::renderer_api = &renderer_api;
+            output->render->ctx = OpenGL::create_gles_context(output);
+        }
+
+        OpenGL::bind_context(output->render->ctx);
+
+        auto& views = get_views(view_count);
+        static int renderer_state;
+        for (auto& view : views)
+            view->surface->renderer_state = &renderer_state;
+
+        pixman_region32_copy(output->render->get_repaint_region(), &output->handle->region);
+        return output;
+    }
+
+    /* changes the global transforms, like the cube or expo do, for a run */
+    struct global_transform
+    {
+        glm::mat4 rotation, scale, translate;
+
+        global_transform()
+        {
+            rotation = glm::rotate(glm::mat4(), 0.3f, glm::vec3(0, 1, 0));
+            scale = glm::scale(glm::mat4(), glm::vec3(0.5, 0.5, 1));
+            translate = glm::translate(glm::mat4(), glm::vec3(0.2, 0, -1));
+            swap();
+        }
+
+        ~global_transform()
+        {
+            swap();
+        }
+
+        void swap()
+        {
+            std::swap(wayfire_view_transform::global_rotation, rotation);
+            std::swap(wayfire_view_transform::global_scale, scale);
+            std::swap(wayfire_view_transform::global_translate, translate);
+        }
+    };
+
+    /* a region which is freed with the benchmark */
+    struct damage_t
+    {
+        pixman_region32_t region;
+
+        damage_t() { pixman_region32_init(&region); }
+        ~damage_t() { pixman_region32_fini(&region); }
+    };
+
+    static setup_t stream_damage_benchmark(size_t view_count,
+            std::function<void(pixman_region32_t*)> make_damage)
+    {
+        return [=] ()
+        {
+            auto output = setup_frame(view_count);
+            auto damage = std::make_shared<damage_t>();
+            make_damage(&damage->region);
+
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    keep(render_benchmark_access::collect_stream_damage(output,
+                                std::make_tuple(0, 0), &damage->region));
+                }
+            };
+        };
+    }
+
+    static void add_frame_benchmarks(size_t view_count)
+    {
+        auto suffix = "/" + std::to_string(view_count);
+
+        /* transformation_renderer() of an idle desktop,
+         * nothing should be allocated in the steady state */
+        add("render/frame" + suffix, [=] ()
+        {
+            auto output = setup_frame(view_count);
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    output->render->transformation_renderer();
+
+                keep(gl_calls);
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+
+        /* a small damage, e.g the cursor or a blinking caret,
+         * and the whole workspace, for the first frame of a stream */
+        add("render/stream_damage/small" + suffix,
+                stream_damage_benchmark(view_count, [] (pixman_region32_t *damage)
+        {
+            pixman_region32_union_rect(damage, damage, 600, 400, 32, 32);
+            pixman_region32_union_rect(damage, damage, 1200, 700, 8, 16);
+        }));
+
+        add("render/stream_damage/full" + suffix,
+                stream_damage_benchmark(view_count, [] (pixman_region32_t *damage)
+        {
+            pixman_region32_union_rect(damage, damage, 0, 0,
+                    output_width, output_height);
+        }));
+    }
+
+    void add_render_benchmarks()
+    {
+        add("render/calculate_total_transform", [] ()
+        {
+            auto transform = std::make_shared<wayfire_view_transform>();
+            transform->rotation = glm::rotate(glm::mat4(), 0.5f, glm::vec3(0, 0, 1));
+            transform->scale = glm::scale(glm::mat4(), glm::vec3(0.8, 0.8, 1));
+            transform->translation = glm::translate(glm::mat4(), glm::vec3(0.1, 0.1, 0));
+
+            return [=] (uint64_t iterations)
+            {
+                global_transform global;
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(transform->calculate_total_transform());
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+
+        for (size_t count : {10, 100, 1000})
+            add_frame_benchmarks(count);
+    }
+}
@@ -0,0 +1,130 @@
+#include "microbench.hpp"
+
+#include <output.hpp>
+#include <signal_definitions.hpp>
+#include <algorithm>
+
+/* signal_manager before signal ids were interned: callbacks were kept by
+ * name, and copied before each emission. It is the baseline for the emits */
+struct string_signal_manager
+{
+    std::unordered_map<std::string, std::vector<signal_callback_t*>> sig;
+
+    void connect_signal(std::string name, signal_callback_t* callback)
+    {
+        sig[name].push_back(callback);
+    }
+
+    void emit_signal(std::string name, signal_data *data)
+    {
+        std::vector<signal_callback_t> callbacks;
+        for (auto x : sig[name])
+            callbacks.push_back(*x);
+
+        for (auto x : callbacks)
+            x(data);
+    }
+};
+
+namespace microbench
+{
+    static int signals_received = 0;
+
+    /* a signal manager with count callbacks connected to one signal, a plugin
+     * usually captures a pointer and a few values. The callbacks live as
+     * long as the manager, i.e until the benchmark is done */
+    template<class Manager> struct connected
+    {
+        Manager manager;
+        std::vector<signal_callback_t> callbacks;
+
+        connected(int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                int *received = &signals_received;
+                int weight = i + 1;
+                callbacks.push_back([received, weight] (signal_data *data)
+                {
+                    *received += weight;
+                });
+            }
+        }
+    };
+
+    void add_signal_benchmarks()
+    {
+        for (int count : {1, 8})
+        {
+            auto suffix = "/" + std::to_string(count);
+
+            add("signal/emit_typed" + suffix, [=] ()
+            {
+                auto signal = std::make_shared<connected<signal_manager>>(count);
+                for (auto& callback : signal->callbacks)
+                    signal->manager.connect<wf_signal::focus_view>(&callback);
+
+                return [=] (uint64_t iterations)
+                {
+                    focus_view_signal data;
+                    for (uint64_t i = 0; i < iterations; i++)
+                        signal->manager.emit<wf_signal::focus_view>(&data);
+                };
+            }, EXPECT_NO_ALLOCATIONS);
+
+            add("signal/emit_by_name" + suffix, [=] ()
+            {
+                auto signal = std::make_shared<connected<signal_manager>>(count);
+                for (auto& callback : signal->callbacks)
+                    signal->manager.connect_signal("view-fullscreen-request", &callback);
+
+                return [=] (uint64_t iterations)
+                {
+                    view_fullscreen_signal data;
+                    for (uint64_t i = 0; i < iterations; i++)
+                        signal->manager.emit_signal("view-fullscreen-request", &data);
+                };
+            });
+
+            add("signal/emit_baseline" + suffix, [=] ()
+            {
+                auto signal = std::make_shared<connected<string_signal_manager>>(count);
+                for (auto& callback : signal->callbacks)
+                    signal->manager.connect_signal("view-fullscreen-request", &callback);
+
+                return [=] (uint64_t iterations)
+                {
+                    view_fullscreen_signal data;
+                    for (uint64_t i = 0; i < iterations; i++)
+                        signal->manager.emit_signal("view-fullscreen-request", &data);
+                };
+            });
+        }
+
+        /* a callback which disconnects itself, like one-shot plugin hooks */
+        add("signal/emit_disconnecting", [] ()
+        {
+            auto signal = std::make_shared<connected<signal_manager>>(4);
+            for (auto& callback : signal->callbacks)
+                signal->manager.connect<wf_signal::focus_view>(&callback);
+
+            auto one_shot = std::make_shared<signal_callback_t>();
+            auto manager = &signal->manager;
+            auto one_shot_ptr = one_shot.get();
+            *one_shot = [=] (signal_data *data)
+            {
+                manager->disconnect<wf_signal::focus_view>(one_shot_ptr);
+            };
+
+            return [=] (uint64_t iterations)
+            {
+                focus_view_signal data;
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    signal->manager.connect<wf_signal::focus_view>(one_shot.get());
+                    signal->manager.emit<wf_signal::focus_view>(&data);
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+    }
+}
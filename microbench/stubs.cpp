@@ -0,0 +1,407 @@
+#include "stubs.hpp"
+
+#include <input-manager.hpp>
+#include <opengl.hpp>
+#include <signal_definitions.hpp>
+#include <libweston-desktop.h>
+#include <xwayland-api.h>
+#include <libevdev/libevdev.h>
+#include <linux/input.h>
+#include <cstring>
+
+/* Stubs of libweston and of the parts of wayfire which aren't built into
+ * wayfire-microbench. They do what the real ones would do to the fake
+ * structures, as far as the benchmarked code can see */
+
+std::ofstream wf_debug::logfile;
+wayfire_core *core;
+
+extern "C"
+{
+    /* libwayland-server */
+    wl_event_loop *wl_display_get_event_loop(wl_display *display)
+    {
+        return nullptr;
+    }
+
+    wl_event_source *wl_event_loop_add_idle(wl_event_loop *loop,
+            wl_event_loop_idle_func_t func, void *data)
+    {
+        return nullptr;
+    }
+
+    /* libweston */
+    void weston_layer_init(weston_layer *layer, weston_compositor *compositor)
+    {
+        layer->compositor = compositor;
+        layer->view_list.layer = layer;
+        wl_list_init(&layer->view_list.link);
+        wl_list_init(&layer->link);
+    }
+
+    void weston_layer_set_position(weston_layer *layer, weston_layer_position position)
+    {
+        layer->position = position;
+    }
+
+    void weston_layer_unset_position(weston_layer *layer)
+    {
+        layer->position = WESTON_LAYER_POSITION_HIDDEN;
+    }
+
+    void weston_layer_entry_insert(weston_layer_entry *list, weston_layer_entry *entry)
+    {
+        wl_list_insert(&list->link, &entry->link);
+        entry->layer = list->layer;
+    }
+
+    void weston_layer_entry_remove(weston_layer_entry *entry)
+    {
+        wl_list_remove(&entry->link);
+        wl_list_init(&entry->link);
+        entry->layer = NULL;
+    }
+
+    void weston_view_set_position(weston_view *view, float x, float y) {}
+    void weston_view_update_transform(weston_view *view) {}
+
+    bool weston_surface_is_mapped(weston_surface *surface)
+    {
+        return surface->is_mapped;
+    }
+
+    void weston_output_schedule_repaint(weston_output *output) {}
+    void weston_output_damage(weston_output *output) {}
+
+    void weston_touch_send_down(weston_touch *touch, uint32_t time,
+            int touch_id, wl_fixed_t x, wl_fixed_t y) {}
+    void weston_touch_send_up(weston_touch *touch, uint32_t time, int touch_id) {}
+
+    /* libweston-desktop */
+    weston_view *weston_desktop_surface_create_view(weston_desktop_surface *surface)
+    {
+        auto view = new weston_view();
+        view->surface = surface->surface;
+        view->layer_link.layer = NULL;
+        wl_list_init(&view->layer_link.link);
+        pixman_region32_init(&view->damage_clip_region);
+        pixman_region32_init(&view->transform.opaque);
+
+        return view;
+    }
+
+    weston_surface *weston_desktop_surface_get_surface(weston_desktop_surface *surface)
+    {
+        return surface->surface;
+    }
+
+    weston_geometry weston_desktop_surface_get_geometry(weston_desktop_surface *surface)
+    {
+        return surface->geometry;
+    }
+
+    void weston_desktop_surface_set_user_data(weston_desktop_surface *surface, void *user_data)
+    {
+        surface->user_data = user_data;
+    }
+
+    void weston_desktop_surface_set_activated(weston_desktop_surface *surface, bool activated) {}
+
+    /* there is no client to resize its buffer */
+    void weston_desktop_surface_set_size(weston_desktop_surface *surface,
+            int32_t width, int32_t height) {}
+
+    void weston_desktop_surface_set_maximized(weston_desktop_surface *surface, bool maximized)
+    {
+        surface->maximized = maximized;
+    }
+
+    void weston_desktop_surface_set_fullscreen(weston_desktop_surface *surface, bool fullscreen)
+    {
+        surface->fullscreen = fullscreen;
+    }
+
+    bool weston_desktop_surface_get_maximized(weston_desktop_surface *surface)
+    {
+        return surface->maximized;
+    }
+
+    bool weston_desktop_surface_get_fullscreen(weston_desktop_surface *surface)
+    {
+        return surface->fullscreen;
+    }
+
+    const weston_xwayland_surface_api *
+    weston_xwayland_surface_get_api(weston_compositor *compositor)
+    {
+        return nullptr;
+    }
+
+    /* libevdev, only the names used in the benchmark configs */
+    int libevdev_event_code_from_name(unsigned int type, const char *name)
+    {
+        static const struct { const char *name; int code; } codes[] = {
+            {"KEY_A", KEY_A}, {"KEY_C", KEY_C}, {"KEY_E", KEY_E},
+            {"KEY_F", KEY_F}, {"KEY_Q", KEY_Q}, {"KEY_R", KEY_R},
+            {"KEY_T", KEY_T}, {"KEY_TAB", KEY_TAB}, {"KEY_ENTER", KEY_ENTER},
+            {"KEY_LEFT", KEY_LEFT}, {"KEY_RIGHT", KEY_RIGHT},
+            {"KEY_UP", KEY_UP}, {"KEY_DOWN", KEY_DOWN},
+            {"BTN_LEFT", BTN_LEFT}, {"BTN_RIGHT", BTN_RIGHT},
+            {"BTN_MIDDLE", BTN_MIDDLE},
+        };
+
+        for (auto& code : codes)
+        {
+            if (!std::strcmp(code.name, name))
+                return code.code;
+        }
+
+        return -1;
+    }
+}
+
+/* core, views are indexed like in the real add_view() and erase_view(),
+ * and always go to the single output */
+void wayfire_core::add_view(weston_desktop_surface *ds)
+{
+    auto view = std::make_shared<wayfire_view_t> (ds);
+    views[view->handle] = view;
+    views_by_desktop_surface[view->desktop_surface] = view;
+    views_by_surface[view->surface] = view;
+
+    active_output->attach_view(view);
+}
+
+void wayfire_core::erase_view(wayfire_view v, bool destroy_handle)
+{
+    if (!v) return;
+
+    views.erase(v->handle);
+    views_by_desktop_surface.erase(v->desktop_surface);
+    views_by_surface.erase(v->surface);
+    v->output->detach_view(v);
+}
+
+void wayfire_core::focus_output(wayfire_output *o)
+{
+    active_output = o;
+}
+
+wayfire_output* wayfire_core::get_active_output()
+{
+    return active_output;
+}
+
+weston_seat* wayfire_core::get_current_seat()
+{
+    return nullptr;
+}
+
+/* input_manager, there are no touch bindings or grabs */
+input_manager::input_manager() {}
+void input_manager::grab_send_touch_down(weston_touch*, int32_t, wl_fixed_t, wl_fixed_t) {}
+void input_manager::grab_send_touch_up(weston_touch*, int32_t) {}
+void input_manager::check_touch_bindings(weston_touch*, wl_fixed_t sx, wl_fixed_t sy) {}
+
+/* output, without plugins other than the viewport implementation */
+const weston_gl_renderer_api *render_manager::renderer_api = nullptr;
+
+render_manager::render_manager(wayfire_output *o)
+{
+    output = o;
+    output->output_dx = output->output_dy = 0;
+
+    pixman_region32_init(&frame_damage);
+    pixman_region32_init(&repaint_region);
+    pixman_region32_init(&frame_scratch.ws_damage);
+    pixman_region32_init(&frame_scratch.visible);
+    pixman_region32_init(&frame_scratch.surface_damage);
+}
+
+render_manager::~render_manager()
+{
+    for (auto& dv : frame_scratch.damaged_views)
+        pixman_region32_fini(&dv.damage);
+
+    pixman_region32_fini(&frame_damage);
+    pixman_region32_fini(&repaint_region);
+    pixman_region32_fini(&frame_scratch.ws_damage);
+    pixman_region32_fini(&frame_scratch.visible);
+    pixman_region32_fini(&frame_scratch.surface_damage);
+}
+
+wayfire_output::wayfire_output(weston_output *handle, wayfire_config *c)
+{
+    this->handle = handle;
+
+    render = new render_manager(this);
+    signal = new signal_manager();
+    workspace = nullptr;
+    plugin = nullptr;
+}
+
+wayfire_output::~wayfire_output()
+{
+    delete signal;
+    delete render;
+}
+
+weston_geometry wayfire_output::get_full_geometry()
+{
+    return {handle->x, handle->y,
+            handle->width, handle->height};
+}
+
+wl_output_transform wayfire_output::get_transform()
+{
+    return WL_OUTPUT_TRANSFORM_NORMAL;
+}
+
+std::tuple<int, int> wayfire_output::get_screen_size()
+{
+    return std::make_tuple(handle->width, handle->height);
+}
+
+void wayfire_output::attach_view(wayfire_view v)
+{
+    v->output = this;
+    pixman_region32_copy(&v->handle->damage_clip_region, &handle->region);
+
+    workspace->view_bring_to_front(v);
+
+    auto sig_data = create_view_signal{v};
+    signal->emit<wf_signal::attach_view>(&sig_data);
+}
+
+void wayfire_output::detach_view(wayfire_view v)
+{
+    auto sig_data = destroy_view_signal{v};
+    signal->emit<wf_signal::detach_view>(&sig_data);
+
+    if (v->keep_count <= 0)
+        workspace->view_removed(v);
+}
+
+void wayfire_output::bring_to_front(wayfire_view v)
+{
+    weston_layer_entry_remove(&v->handle->layer_link);
+    workspace->view_bring_to_front(v);
+}
+
+void wayfire_output::focus_view(wayfire_view v, weston_seat *seat)
+{
+    if (v)
+        bring_to_front(v);
+
+    focus_view_signal data;
+    data.focus = v;
+    signal->emit<wf_signal::focus_view>(&data);
+}
+
+void wayfire_plugin_t::fini() {}
+
+extern "C" wayfire_plugin_t *newInstance();
+
+namespace microbench
+{
+    static struct
+    {
+        weston_compositor compositor;
+        weston_output handle;
+        wayfire_output *output = nullptr;
+    } env;
+
+    wayfire_output *get_output()
+    {
+        if (env.output)
+            return env.output;
+
+        core = new wayfire_core();
+        core->ec = &env.compositor;
+        core->input = new input_manager();
+        core->vwidth = core->vheight = 3;
+
+        std::memset(&env.handle, 0, sizeof(env.handle));
+        env.handle.width = output_width;
+        env.handle.height = output_height;
+        pixman_region32_init_rect(&env.handle.region, 0, 0, output_width, output_height);
+        wl_list_init(&env.handle.animation_list);
+
+        env.output = new wayfire_output(&env.handle, nullptr);
+        core->focus_output(env.output);
+
+        /* the plugin sets output->workspace */
+        auto viewport_impl = newInstance();
+        viewport_impl->output = env.output;
+        viewport_impl->init(nullptr);
+
+        return env.output;
+    }
+
+    wayfire_view create_view(weston_geometry geometry)
+    {
+        get_output();
+
+        auto surface = new weston_surface();
+        surface->width = geometry.width;
+        surface->height = geometry.height;
+        surface->is_mapped = true;
+        wl_list_init(&surface->subsurface_list);
+
+        auto ds = new weston_desktop_surface();
+        ds->surface = surface;
+        ds->geometry = {0, 0, geometry.width, geometry.height};
+
+        core->add_view(ds);
+
+        auto view = core->find_view(ds);
+        view->geometry = geometry;
+        view->is_mapped = true;
+        view->handle->is_mapped = true;
+        pixman_region32_init_rect(&view->handle->transform.opaque,
+                geometry.x, geometry.y, geometry.width, geometry.height);
+
+        /* the view was indexed with an empty geometry */
+        env.output->workspace->view_geometry_changed(view);
+
+        return view;
+    }
+
+    void destroy_view(wayfire_view view)
+    {
+        core->erase_view(view);
+
+        auto handle = view->handle;
+        auto ds = view->desktop_surface;
+        auto surface = view->surface;
+
+        pixman_region32_fini(&handle->damage_clip_region);
+        pixman_region32_fini(&handle->transform.opaque);
+        delete handle;
+        delete ds;
+        delete surface;
+    }
+
+    const std::vector<wayfire_view>& get_views(size_t count)
+    {
+        static std::vector<wayfire_view> views;
+
+        const int width = 400, height = 300;
+        while (views.size() < count)
+        {
+            /* the same places in each run, so that the results are comparable */
+            int i = views.size();
+            int x = (i * 7919) % (3 * output_width - width);
+            int y = (i * 104729) % (3 * output_height - height);
+            views.push_back(create_view({x, y, width, height}));
+        }
+
+        while (views.size() > count)
+        {
+            destroy_view(views.back());
+            views.pop_back();
+        }
+
+        return views;
+    }
+}
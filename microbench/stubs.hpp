@@ -0,0 +1,31 @@
+#ifndef MICROBENCH_STUBS_HPP
+#define MICROBENCH_STUBS_HPP
+
+#include <core.hpp>
+#include <output.hpp>
+
+/* The compositor the benchmarks run in: core with a single 1920x1080
+ * output, whose workspaces are managed by the real viewport plugin.
+ * The libweston functions and the parts of wayfire which aren't built
+ * into wayfire-microbench are stubbed in stubs.cpp */
+namespace microbench
+{
+    const int output_width = 1920, output_height = 1080;
+
+    wayfire_output *get_output();
+
+    /* a mapped view of a fake client, known to core and in the workspace
+     * manager of the output, on top of the other views */
+    wayfire_view create_view(weston_geometry geometry);
+    /* removes the view from core and the workspace manager */
+    void destroy_view(wayfire_view view);
+
+    /* views scattered over all workspaces, for the benchmarks which need many.
+     * Views are created or destroyed so that there are exactly count of them */
+    const std::vector<wayfire_view>& get_views(size_t count);
+
+    /* the calls made to the stub GL in gl.cpp */
+    extern uint64_t gl_calls;
+}
+
+#endif /* end of include guard: MICROBENCH_STUBS_HPP */
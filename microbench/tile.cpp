@@ -0,0 +1,131 @@
+#include "microbench.hpp"
+#include "stubs.hpp"
+
+#include <tree-definition.hpp>
+
+namespace microbench
+{
+    /* a tile tree built directly from nodes, freed with its views
+     * when the benchmark is done with it */
+    struct tile_tree
+    {
+        wf_tree_node *root;
+        std::vector<wayfire_view> views;
+
+        tile_tree()
+        {
+            root = new wf_tree_node;
+            root->box = get_output()->get_full_geometry();
+        }
+
+        ~tile_tree()
+        {
+            free_node(root);
+            for (auto view : views)
+                destroy_view(view);
+        }
+
+        void free_node(wf_tree_node *node)
+        {
+            for (auto child : node->children)
+                free_node(child);
+
+            if (node->view)
+                node->unset_content();
+            delete node;
+        }
+
+        wf_tree_node *add_child(wf_tree_node *parent, bool with_view)
+        {
+            auto child = new wf_tree_node;
+            child->box = parent->box;
+            child->set_parent(parent);
+            parent->children.push_back(child);
+
+            if (with_view)
+            {
+                views.push_back(create_view(child->box));
+                child->set_content(views.back());
+            }
+
+            return child;
+        }
+
+        static wf_split_type split_at(int depth)
+        {
+            return depth % 2 ? SPLIT_HORIZONTAL : SPLIT_VERTICAL;
+        }
+
+        /* each level splits into a leaf and the next level, so that
+         * the windows spiral inwards, like when tiling with the defaults */
+        void build_chain(int depth, bool with_views)
+        {
+            auto node = root;
+            for (int i = 0; i < depth; i++)
+            {
+                node->split_type = split_at(i);
+                add_child(node, with_views);
+                node = add_child(node, with_views && i == depth - 1);
+            }
+        }
+
+        void build_balanced(wf_tree_node *node, int depth)
+        {
+            if (depth == 0)
+            {
+                views.push_back(create_view(node->box));
+                node->set_content(views.back());
+                return;
+            }
+
+            node->split_type = split_at(depth);
+            build_balanced(add_child(node, false), depth - 1);
+            build_balanced(add_child(node, false), depth - 1);
+        }
+    };
+
+    /* like resizing the output or the root of the tree,
+     * the box changes every time so that the views are really moved */
+    static run_t relayout(std::shared_ptr<tile_tree> tree)
+    {
+        return [=] (uint64_t iterations)
+        {
+            auto box = get_output()->get_full_geometry();
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                box.width = output_width - (i & 1);
+                tree->root->set_geometry(box);
+            }
+
+            keep(tree->root->box);
+        };
+    }
+
+    void add_tile_benchmarks()
+    {
+        for (int depth : {16, 64})
+        {
+            add("tile/recalculate/chain/" + std::to_string(depth), [=] ()
+            {
+                auto tree = std::make_shared<tile_tree>();
+                tree->build_chain(depth, true);
+                return relayout(tree);
+            }, EXPECT_NO_ALLOCATIONS);
+        }
+
+        add("tile/recalculate/balanced/256", [] ()
+        {
+            auto tree = std::make_shared<tile_tree>();
+            tree->build_balanced(tree->root, 8);
+            return relayout(tree);
+        }, EXPECT_NO_ALLOCATIONS);
+
+        /* only the box math, without moving views */
+        add("tile/recalculate/chain_no_views/64", [] ()
+        {
+            auto tree = std::make_shared<tile_tree>();
+            tree->build_chain(64, false);
+            return relayout(tree);
+        }, EXPECT_NO_ALLOCATIONS);
+    }
+}
@@ -0,0 +1,136 @@
+#include "microbench.hpp"
+#include "stubs.hpp"
+
+namespace microbench
+{
+    static const size_t view_counts[] = {10, 100, 1000, 10000};
+
+    static void add_view_lookup_benchmarks(size_t count)
+    {
+        auto suffix = "/" + std::to_string(count);
+
+        /* the handles libweston passes to the callbacks, cycling through
+         * all views so that the lookup isn't always for the same */
+        add("core/find_view/handle" + suffix, [=] ()
+        {
+            auto& views = get_views(count);
+            return [&views] (uint64_t iterations)
+            {
+                size_t j = 0;
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    keep(core->find_view(views[j]->handle).get());
+                    if (++j == views.size())
+                        j = 0;
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+
+        add("core/find_view/desktop_surface" + suffix, [=] ()
+        {
+            auto& views = get_views(count);
+            return [&views] (uint64_t iterations)
+            {
+                size_t j = 0;
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    keep(core->find_view(views[j]->desktop_surface).get());
+                    if (++j == views.size())
+                        j = 0;
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+
+        add("core/find_view/surface" + suffix, [=] ()
+        {
+            auto& views = get_views(count);
+            return [&views] (uint64_t iterations)
+            {
+                size_t j = 0;
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    keep(core->find_view(views[j]->surface).get());
+                    if (++j == views.size())
+                        j = 0;
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+    }
+
+    static void add_workspace_query_benchmarks(size_t count)
+    {
+        auto suffix = "/" + std::to_string(count);
+
+        add("workspace/get_views_on_workspace" + suffix, [=] ()
+        {
+            get_views(count);
+            auto workspace = get_output()->workspace;
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                    keep(workspace->get_views_on_workspace(std::make_tuple(1, 1)).size());
+            };
+        });
+
+        /* what the renderer does each frame */
+        add("workspace/get_renderable_views" + suffix, [=] ()
+        {
+            get_views(count);
+            auto workspace = get_output()->workspace;
+            auto views = std::make_shared<std::vector<wayfire_view>>();
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    workspace->get_renderable_views_on_workspace(std::make_tuple(0, 0), *views);
+                    keep(views->size());
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+
+        /* a frame while a window is dragged around the current workspace */
+        add("workspace/get_renderable_views_after_move" + suffix, [=] ()
+        {
+            auto& all = get_views(count);
+            auto view = all.front();
+            auto workspace = get_output()->workspace;
+            auto views = std::make_shared<std::vector<wayfire_view>>();
+            return [=] (uint64_t iterations)
+            {
+                auto g = view->geometry;
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    view->move(g.x + (i & 1), g.y);
+                    workspace->get_renderable_views_on_workspace(std::make_tuple(0, 0), *views);
+                    keep(views->size());
+                }
+
+                view->move(g.x, g.y);
+            };
+        });
+
+        add("workspace/get_view_at_point" + suffix, [=] ()
+        {
+            get_views(count);
+            auto workspace = get_output()->workspace;
+            return [=] (uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++)
+                {
+                    int x = (i * 37) % output_width;
+                    int y = (i * 101) % output_height;
+                    keep(workspace->get_view_at_point(x, y).get());
+                }
+            };
+        }, EXPECT_NO_ALLOCATIONS);
+    }
+
+    void add_workspace_benchmarks()
+    {
+        for (auto count : view_counts)
+            add_view_lookup_benchmarks(count);
+
+        for (auto count : view_counts)
+            add_workspace_query_benchmarks(count);
+    }
+}
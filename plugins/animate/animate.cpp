@@ -44,7 +44,23 @@ struct animation_hook
     bool effect_running = true;
     bool first_run = true;
 
-    animation_hook(wayfire_grab_interface ifc, wayfire_view view, int frame_count) :
+    /* fade and zoom draw only inside the view, the others can draw anywhere */
+    static constexpr bool reports_damage =
+        std::is_same<animation_type, fade_animation>::value ||
+        std::is_same<animation_type, zoom_animation>::value;
+
+    void damage_view()
+    {
+        auto box = view->geometry;
+        box.x -= view->ds_geometry.x;
+        box.y -= view->ds_geometry.y;
+        box.width = view->surface->width;
+        box.height = view->surface->height;
+
+        output->render->damage(box);
+    }
+
+    animation_hook(wayfire_grab_interface ifc, wayfire_view view, int duration) :
         iface(ifc)
     {
         this->view = view;
@@ -69,12 +85,14 @@ struct animation_hook
             if (first_run)
             {
                 base = static_cast<animation_base*> (new animation_type());
-                base->init(view, frame_count, close_animation);
+                base->init(view, duration, close_animation);
                 first_run = false;
             }
 
             if (!base->step())
                 delete_hook(this);
+            else if (reports_damage)
+                damage_view();
         };
 
         output->render->add_output_effect(&hook);
@@ -95,7 +113,9 @@ struct animation_hook
 
         output->render->auto_redraw(true);
         debug << "animate: set renderer " << output->handle->id << " " << view->desktop_surface << std::endl;
-        output->render->set_renderer();
+        output->render->set_renderer(nullptr, reports_damage);
+        if (reports_damage)
+            damage_view();
     }
 
     ~animation_hook()
@@ -123,7 +143,11 @@ struct animation_hook
         view->transform.color[3] = 1;
 
         if (close_animation)
+        {
+            /* the view is kept in the workspace until the animation ends */
+            output->workspace->view_removed(view);
             weston_surface_destroy(view->surface);
+        }
     }
 };
 
@@ -131,7 +155,7 @@ class wayfire_animation : public wayfire_plugin_t {
     signal_callback_t create_cb, destroy_cb, wake_cb;
 
     std::string open_animation, close_animation;
-    int frame_count;
+    int duration;
     int startup_duration;
 
     public:
@@ -143,8 +167,8 @@ class wayfire_animation : public wayfire_plugin_t {
         auto section = config->get_section("animate");
         open_animation = section->get_string("open_animation", "fade");
         close_animation = section->get_string("close_animation", "fade");
-        frame_count = section->get_duration("duration", 16);
-        startup_duration = section->get_duration("startup_duration", 36);
+        duration = section->get_duration("duration", 256);
+        startup_duration = section->get_duration("startup_duration", 576);
 
 #if not USE_GLES32
         if(open_animation == "fire" || close_animation == "fire")
@@ -187,11 +211,11 @@ class wayfire_animation : public wayfire_plugin_t {
             data->created_view->surface->ref_count++;
 
         if (open_animation == "fade")
-            new animation_hook<fade_animation, false>(grab_interface, data->created_view, frame_count);
+            new animation_hook<fade_animation, false>(grab_interface, data->created_view, duration);
         else if (open_animation == "zoom")
-            new animation_hook<zoom_animation, false>(grab_interface, data->created_view, frame_count);
+            new animation_hook<zoom_animation, false>(grab_interface, data->created_view, duration);
         else if (open_animation == "fire")
-            new animation_hook<wf_fire_effect, false>(grab_interface, data->created_view, frame_count);
+            new animation_hook<wf_fire_effect, false>(grab_interface, data->created_view, duration);
     }
 
     void view_destroyed(signal_data *ddata)
@@ -204,11 +228,11 @@ class wayfire_animation : public wayfire_plugin_t {
             return;
 
         if (close_animation == "fade")
-            new animation_hook<fade_animation, true> (grab_interface, data->destroyed_view, frame_count);
+            new animation_hook<fade_animation, true> (grab_interface, data->destroyed_view, duration);
         else if (close_animation == "zoom")
-            new animation_hook<zoom_animation, true> (grab_interface, data->destroyed_view, frame_count);
+            new animation_hook<zoom_animation, true> (grab_interface, data->destroyed_view, duration);
         else if (close_animation == "fire")
-            new animation_hook<wf_fire_effect, true> (grab_interface, data->destroyed_view, frame_count);
+            new animation_hook<wf_fire_effect, true> (grab_interface, data->destroyed_view, duration);
     }
 
     void fini()
@@ -6,7 +6,7 @@
 class animation_base
 {
     public:
-    virtual void init(wayfire_view view, int frame_count, bool close);
+    virtual void init(wayfire_view view, int duration_ms, bool close);
     virtual bool step(); /* return true if continue, false otherwise */
     virtual ~animation_base();
 };
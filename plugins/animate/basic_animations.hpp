@@ -7,15 +7,15 @@ class fade_animation : public animation_base
     wayfire_view view;
 
     float start = 0, end = 1;
-    int total_frames, current_frame;
+    wf_duration duration;
 
     public:
 
-    void init(wayfire_view view, int tf, bool close)
+    void init(wayfire_view view, int dur, bool close)
     {
         this->view = view;
-        total_frames = tf;
-        current_frame = 0;
+        duration = wf_duration(dur);
+        duration.start();
 
         if (close)
             std::swap(start, end);
@@ -24,11 +24,11 @@ class fade_animation : public animation_base
 
     bool step()
     {
-        view->transform.color[3] = GetProgress(start, end, current_frame, total_frames);
+        view->transform.color[3] = duration.progress(start, end);
         view->simple_render();
         view->transform.color[3] = 0.0f;
 
-        return current_frame++ < total_frames;
+        return duration.running();
     }
 
     ~fade_animation()
@@ -43,15 +43,15 @@ class zoom_animation : public animation_base
 
     float alpha_start = 0, alpha_end = 1;
     float zoom_start = 1./3, zoom_end = 1;
-    int total_frames, current_frame;
+    wf_duration duration;
 
     public:
 
-    void init(wayfire_view view, int tf, bool close)
+    void init(wayfire_view view, int dur, bool close)
     {
         this->view = view;
-        total_frames = tf;
-        current_frame = 0;
+        duration = wf_duration(dur);
+        duration.start();
 
         if (close)
         {
@@ -63,9 +63,9 @@ class zoom_animation : public animation_base
 
     bool step()
     {
-        view->transform.color[3] = GetProgress(alpha_start, alpha_end, current_frame, total_frames);
+        view->transform.color[3] = duration.progress(alpha_start, alpha_end);
 
-        float c = GetProgress(zoom_start, zoom_end, current_frame, total_frames);
+        float c = duration.progress(zoom_start, zoom_end);
 
         auto og = view->output->get_full_geometry();
 
@@ -90,7 +90,7 @@ class zoom_animation : public animation_base
 
         view->geometry = compositor_geometry;
 
-        return current_frame++ < total_frames;
+        return duration.running();
     }
 
     ~zoom_animation()
@@ -1,6 +1,8 @@
 #include <opengl.hpp>
 #include <cmath>
+#include <algorithm>
 #include "fire.hpp"
+#include "animate-shaders.hpp"
 #include <signal_definitions.hpp>
 #include <chrono>
 #include <img.hpp>
@@ -9,6 +11,11 @@
 #define MIN_PARTICLE_SIZE 0.09
 #define MAX_PARTICLE_SIZE 0.12
 
+/* the particles are simulated with a fixed time step, independent of the
+ * refresh rate. Slow frames catch up with at most FIRE_MAX_STEPS_PER_FRAME */
+#define FIRE_STEP_MS 16
+#define FIRE_MAX_STEPS_PER_FRAME 4
+
 bool run = true;
 
 #define avg(x,y) (((x) + (y))/2.0)
@@ -33,21 +40,8 @@ class fire_particle_system : public wf_particle_system
 
     void load_compute_program()
     {
-        std::string shaderSrcPath = INSTALL_PREFIX"/share/wayfire/animate/shaders";
-
-        computeProg = GL_CALL(glCreateProgram());
-        GLuint css =
-                OpenGL::load_shader(std::string(shaderSrcPath)
-                    .append("/fire_compute.glsl").c_str(),
-                    GL_COMPUTE_SHADER);
-
-        GL_CALL(glAttachShader(computeProg, css));
-        GL_CALL(glLinkProgram(computeProg));
-        GL_CALL(glUseProgram(computeProg));
-
-        GL_CALL(glUniform1i(1, particleLife));
-        GL_CALL(glUniform1f(5, 2 * _w));
-        GL_CALL(glUniform1f(6, 2 * _h));
+        computeProg = OpenGL::create_program({
+                EMBEDDED_SHADER(GL_COMPUTE_SHADER, animate_shaders::fire_compute_glsl)});
 
         if (!data_filled)
         {
@@ -106,10 +100,24 @@ class fire_particle_system : public wf_particle_system
 
         init_gles_part();
         set_particle_color(glm::vec4(0.4, 0.17, 0.05, 0.3 + w * 0.1), glm::vec4(0.4, 0.17, 0.05, 0.3));
+    }
+
+    void set_render_uniforms()
+    {
+        float data[] = {global_dx, global_dy};
 
-        GL_CALL(glUseProgram(renderProg));
         GL_CALL(glUniform1f(4, particleSize * 0.8));
-        GL_CALL(glUseProgram(0));
+        GL_CALL(glUniform2fv(3, 1, data));
+    }
+
+    void set_compute_uniforms()
+    {
+        wf_particle_system::set_compute_uniforms();
+
+        GL_CALL(glUniform1f(5, 2 * _w));
+        GL_CALL(glUniform1f(6, 2 * _h));
+        GL_CALL(glUniform1f(7, gravity));
+        GL_CALL(glUniform1f(8, 0.5 * currentIteration / effect_cycles));
     }
 
     int check()
@@ -122,10 +130,6 @@ class fire_particle_system : public wf_particle_system
 
     void simulate()
    {
-        GL_CALL(glUseProgram(computeProg));
-        GL_CALL(glUniform1f(7, gravity));
-        GL_CALL(glUniform1f(8, 0.5 * currentIteration / effect_cycles));
-
         GL_CALL(glBindTexture(GL_TEXTURE_2D, rand_tex));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
@@ -142,20 +146,15 @@ class fire_particle_system : public wf_particle_system
     {
         global_dx += dx;
         global_dy += dy;
-
-        float data[] = {global_dx, global_dy};
-
-        GL_CALL(glUseProgram(renderProg));
-        GL_CALL(glUniform2fv(3, 1, data));
     }
 };
 
-void wf_fire_effect::init(wayfire_view win, int fr_cnt, bool burnout)
+void wf_fire_effect::init(wayfire_view win, int duration, bool burnout)
 {
 
     this->burnout = burnout;
     this->w = win;
-    effect_cycles = fr_cnt;
+    int fr_cnt = std::max(1, duration / FIRE_STEP_MS);
 
     auto x = w->geometry.x,
          y = w->geometry.y,
@@ -186,6 +185,7 @@ void wf_fire_effect::init(wayfire_view win, int fr_cnt, bool burnout)
 
     win->transform.color = glm::vec4(1, 1, 1, 0);
     progress = 0;
+    start_time = wf_get_frame_time();
 
     last_geometry = win->geometry;
 }
@@ -207,8 +207,13 @@ bool wf_fire_effect::step()
         last_geometry = w->geometry;
     }
 
-    ps->simulate();
-    adjust_alpha();
+    /* the first frame always runs a step */
+    int target = (wf_get_frame_time() - start_time) / (FIRE_STEP_MS * 1000000ll) + 1;
+    for (int i = 0; i < FIRE_MAX_STEPS_PER_FRAME && progress < target; i++)
+    {
+        ps->simulate();
+        adjust_alpha();
+    }
 
     if(w->is_mapped)
     {
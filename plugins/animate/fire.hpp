@@ -15,12 +15,13 @@ class wf_fire_effect : public animation_base
     weston_geometry last_geometry;
 
     int progress = 0, effect_cycles;
+    int64_t start_time;
     bool burnout;
 
     void adjust_alpha();
 
     public:
-        void init(wayfire_view win, int fr_cnt, bool burnout);
+        void init(wayfire_view win, int duration, bool burnout);
         bool step();
         ~wf_fire_effect();
 };
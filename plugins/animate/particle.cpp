@@ -1,4 +1,5 @@
 #include "particle.hpp"
+#include "animate-shaders.hpp"
 #include <opengl.hpp>
 
 #include <GLES3/gl32.h>
@@ -41,40 +42,32 @@ T *get_shader_storage_buffer(GLuint bufID, size_t arrSize)
 
 void wf_particle_system::load_rendering_program()
 {
-    renderProg = glCreateProgram();
-    GLuint vss, fss;
-    std::string shaderSrcPath = INSTALL_PREFIX"/share/wayfire/animate/shaders";
-
-    vss = OpenGL::load_shader(std::string(shaderSrcPath)
-            .append("/vertex.glsl").c_str(), GL_VERTEX_SHADER);
-
-    fss = OpenGL::load_shader(std::string(shaderSrcPath)
-            .append("/frag.glsl").c_str(), GL_FRAGMENT_SHADER);
-
-    GL_CALL(glAttachShader(renderProg, vss));
-    GL_CALL(glAttachShader (renderProg, fss));
-
-    GL_CALL(glLinkProgram (renderProg));
-    GL_CALL(glUseProgram(renderProg));
-
-    GL_CALL(glUniform1f(4, std::sqrt(2.0) * particleSize));
+    renderProg = OpenGL::create_program({
+            EMBEDDED_SHADER(GL_VERTEX_SHADER, animate_shaders::vertex_glsl),
+            EMBEDDED_SHADER(GL_FRAGMENT_SHADER, animate_shaders::frag_glsl)});
 }
 
 void wf_particle_system::load_compute_program()
 {
-    std::string shaderSrcPath = INSTALL_PREFIX"/share/wayfire/animate/shaders";
-
-    computeProg = GL_CALL(glCreateProgram());
-    GLuint css =
-        OpenGL::load_shader(std::string(shaderSrcPath)
-                .append("/compute.glsl").c_str(),
-                GL_COMPUTE_SHADER);
+    computeProg = OpenGL::create_program({
+            EMBEDDED_SHADER(GL_COMPUTE_SHADER, animate_shaders::compute_glsl)});
+}
 
-    GL_CALL(glAttachShader(computeProg, css));
-    GL_CALL(glLinkProgram(computeProg));
-    GL_CALL(glUseProgram(computeProg));
+/* programs are shared between all particle systems,
+ * so uniforms are set each time we use them */
+void wf_particle_system::set_render_uniforms()
+{
+    GL_CALL(glUniform1f(4, std::sqrt(2.0) * particleSize));
+}
 
+void wf_particle_system::set_compute_uniforms()
+{
     GL_CALL(glUniform1i(1, particleLife));
+    GL_CALL(glUniform4fv(2, 1, &startColor[0]));
+    GL_CALL(glUniform4fv(3, 1, &endColor[0]));
+
+    auto tmp = (endColor - startColor) / float(particleLife);
+    GL_CALL(glUniform4fv(4, 1, &tmp[0]));
 }
 
 void wf_particle_system::load_gles_programs()
@@ -208,13 +201,8 @@ void wf_particle_system::init_gles_part()
 void wf_particle_system::set_particle_color(glm::vec4 scol,
                                             glm::vec4 ecol)
 {
-
-    GL_CALL(glUseProgram(computeProg));
-    GL_CALL(glUniform4fv(2, 1, &scol[0]));
-    GL_CALL(glUniform4fv(3, 1, &ecol[0]));
-
-    auto tmp = (ecol - scol) / float(particleLife);
-    GL_CALL(glUniform4fv(4, 1, &tmp[0]));
+    startColor = scol;
+    endColor = ecol;
 }
 
 wf_particle_system::wf_particle_system() {}
@@ -241,8 +229,8 @@ wf_particle_system::~wf_particle_system()
     GL_CALL(glDeleteBuffers(1, &base_mesh));
     GL_CALL(glDeleteVertexArrays(1, &vao));
 
-    GL_CALL(glDeleteProgram(renderProg));
-    GL_CALL(glDeleteProgram(computeProg));
+    OpenGL::release_program(renderProg);
+    OpenGL::release_program(computeProg);
 }
 
 void wf_particle_system::pause () {spawnNew = false;}
@@ -251,6 +239,7 @@ void wf_particle_system::resume() {spawnNew = true; }
 void wf_particle_system::simulate()
 {
     GL_CALL(glUseProgram(computeProg));
+    set_compute_uniforms();
 
     if(currentIteration++ % respawnInterval == 0 && spawnNew)
     {
@@ -293,6 +282,7 @@ void wf_particle_system::simulate()
 void wf_particle_system::render()
 {
     GL_CALL(glUseProgram(renderProg));
+    set_render_uniforms();
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
 
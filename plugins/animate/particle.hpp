@@ -42,8 +42,9 @@ class wf_particle_system
     size_t respawnInterval;
 
     float particleSize;
+    glm::vec4 startColor, endColor;
 
-    GLint renderProg,
+    GLuint renderProg,
           computeProg;
     GLuint vao;
     GLuint base_mesh;
@@ -71,6 +72,10 @@ class wf_particle_system
     virtual void load_compute_program();
     virtual void load_gles_programs();
 
+    /* called after the respective program is bound */
+    virtual void set_render_uniforms();
+    virtual void set_compute_uniforms();
+
     virtual void create_buffers();
 
     /* to change initial particle spawning,
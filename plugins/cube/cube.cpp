@@ -4,6 +4,7 @@
 #include <compositor.h>
 #include <linux/input-event-codes.h>
 #include <config.hpp>
+#include "cube-shaders.hpp"
 
 #if USE_GLES32
 #include <GLES3/gl32.h>
@@ -29,11 +30,15 @@ class wayfire_cube : public wayfire_plugin_t {
     int px, py;
 
     render_hook_t renderer;
+    weston_binding *activate_binding = nullptr;
 
     struct {
         GLuint id = -1;
         GLuint modelID, vpID;
         GLuint posID, uvID;
+#if USE_GLES32
+        GLuint defID, lightID;
+#endif
     } program;
 
     glm::mat4 vp, model, view, project;
@@ -70,7 +75,7 @@ class wayfire_cube : public wayfire_plugin_t {
             initiate(wl_fixed_to_int(ptr->x), wl_fixed_to_int(ptr->y));
         };
 
-        output->add_button(act_button.mod, act_button.button, &activate);
+        activate_binding = output->add_button(act_button.mod, act_button.button, &activate);
 
         grab_interface->callbacks.pointer.button = [=] (weston_pointer*,
                 uint32_t b, uint32_t s)
@@ -102,60 +107,26 @@ class wayfire_cube : public wayfire_plugin_t {
 
     void load_program()
     {
+            /* the program is shared with the cube on other outputs,
+             * so all uniforms are set in render() */
+            program.id = OpenGL::create_program({
+                    EMBEDDED_SHADER(GL_VERTEX_SHADER, cube_shaders::vertex_glsl),
+                    EMBEDDED_SHADER(GL_FRAGMENT_SHADER, cube_shaders::frag_glsl),
 #if USE_GLES32
-            std::string shaderSrcPath =
-                INSTALL_PREFIX "/share/wayfire/cube/shaders_3.2";
-#else
-            std::string shaderSrcPath =
-                INSTALL_PREFIX "/share/wayfire/cube/shaders_2.0";
-#endif
-
-            program.id = GL_CALL(glCreateProgram());
-            GLuint vss, fss, tcs = -1, tes = -1, gss = -1;
-
-            vss = OpenGL::load_shader(std::string(shaderSrcPath)
-                        .append("/vertex.glsl").c_str(), GL_VERTEX_SHADER);
-
-            fss = OpenGL::load_shader(std::string(shaderSrcPath)
-                        .append("/frag.glsl").c_str(), GL_FRAGMENT_SHADER);
-
-            GL_CALL(glAttachShader(program.id, vss));
-            GL_CALL(glAttachShader(program.id, fss));
-
-#if USE_GLES32
-            tcs = OpenGL::load_shader(std::string(shaderSrcPath)
-                    .append("/tcs.glsl").c_str(),
-                    GL_TESS_CONTROL_SHADER);
-
-            tes = OpenGL::load_shader(std::string(shaderSrcPath)
-                    .append("/tes.glsl").c_str(),
-                    GL_TESS_EVALUATION_SHADER);
-
-            gss = OpenGL::load_shader(std::string(shaderSrcPath)
-                    .append("/geom.glsl").c_str(),
-                    GL_GEOMETRY_SHADER);
-            GL_CALL(glAttachShader(program.id, tcs));
-            GL_CALL(glAttachShader(program.id, tes));
-            GL_CALL(glAttachShader(program.id, gss));
+                    EMBEDDED_SHADER(GL_TESS_CONTROL_SHADER, cube_shaders::tcs_glsl),
+                    EMBEDDED_SHADER(GL_TESS_EVALUATION_SHADER, cube_shaders::tes_glsl),
+                    EMBEDDED_SHADER(GL_GEOMETRY_SHADER, cube_shaders::geom_glsl),
 #endif
-
-            GL_CALL(glLinkProgram(program.id));
-            GL_CALL(glUseProgram(program.id));
-
+            });
 
             program.vpID = GL_CALL(glGetUniformLocation(program.id, "VP"));
-            GL_CALL(glUniformMatrix4fv(program.vpID, 1, GL_FALSE, &vp[0][0]));
-
             program.uvID = GL_CALL(glGetAttribLocation(program.id, "uvPosition"));
             program.posID = GL_CALL(glGetAttribLocation(program.id, "position"));
             program.modelID = GL_CALL(glGetUniformLocation(program.id, "model"));
 
 #if USE_GLES32
-            GLuint defID = GL_CALL(glGetUniformLocation(program.id, "deform"));
-            glUniform1i(defID, use_deform);
-
-            GLuint lightID = GL_CALL(glGetUniformLocation(program.id, "light"));
-            glUniform1i(lightID, use_light);
+            program.defID = GL_CALL(glGetUniformLocation(program.id, "deform"));
+            program.lightID = GL_CALL(glGetUniformLocation(program.id, "light"));
 #endif
 
             GetTuple(vw, vh, output->workspace->get_workspace_grid_size());
@@ -168,7 +139,6 @@ class wayfire_cube : public wayfire_plugin_t {
 
             for(int i = 0; i < vw; i++) {
                 streams[i] = new wf_workspace_stream;
-                streams[i]->fbuff = streams[i]->tex = -1;
             }
 
             project = glm::perspective(45.0f, 1.f, 0.1f, 100.f);
@@ -224,6 +194,11 @@ class wayfire_cube : public wayfire_plugin_t {
 
         GL_CALL(glUniformMatrix4fv(program.vpID, 1, GL_FALSE, &vp[0][0]));
 
+#if USE_GLES32
+        GL_CALL(glUniform1i(program.defID, use_deform));
+        GL_CALL(glUniform1i(program.lightID, use_light));
+#endif
+
         glm::mat4 base_model = glm::scale(glm::mat4(),
                 glm::vec3(1. / zoomFactor, 1. / zoomFactor,
                     1. / zoomFactor));
@@ -262,7 +237,7 @@ class wayfire_cube : public wayfire_plugin_t {
             GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
             GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, streams[index]->tex));
+            GL_CALL(glBindTexture(GL_TEXTURE_2D, streams[index]->buffer.tex));
             GL_CALL(glActiveTexture(GL_TEXTURE0));
 
             model = glm::rotate(base_model,
@@ -322,6 +297,21 @@ class wayfire_cube : public wayfire_plugin_t {
         if (zoomFactor <= 0.1)
             zoomFactor = 0.1;
     }
+
+    void fini()
+    {
+        if (output->is_plugin_active(grab_interface->name))
+            terminate();
+
+        if (activate_binding)
+            weston_binding_destroy(activate_binding);
+
+        if (program.id != (uint)-1)
+            OpenGL::release_program(program.id);
+
+        for (auto stream : streams)
+            delete stream;
+    }
 };
 
 extern "C" {
@@ -0,0 +1,459 @@
+#include <output.hpp>
+#include <core.hpp>
+#include <signal_definitions.hpp>
+#include <metrics.hpp>
+#include <opengl.hpp>
+#include <linux/input.h>
+#include <compositor.h>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "../../shared/config.hpp"
+
+/* Drives scripted scenarios with synthetic input and reports the frame
+ * times of each of them as JSON. It is meant to be used by wayfire-bench
+ * with the headless backend, or nested for the GL scenarios, runs only on
+ * the first output and terminates the compositor when all scenarios are done */
+class wayfire_bench : public wayfire_plugin_t
+{
+    struct step
+    {
+        /* milliseconds to wait before the action */
+        int delay;
+        std::function<void()> action;
+        /* the step is repeated until it returns true */
+        std::function<bool()> done;
+    };
+
+    std::vector<step> steps;
+    size_t current_step = 0;
+    wl_event_source *timer = nullptr;
+
+    weston_seat *seat;
+    wayfire_config *config;
+    std::string client, results_file;
+    int windows, scenario_duration;
+
+    /* the scenario which is being measured */
+    std::string scenario;
+    wf_histogram paint;
+    uint64_t missed_deadlines = 0;
+    std::vector<std::string> results;
+    /* extra fields of the scenario's results */
+    std::string details;
+
+    /* the frame_clock scenario runs a frame hook on a fake clock, which is a
+     * day ahead of the real one. Each prediction must be later than the last
+     * one, and in the refresh period after the time at which the hook runs */
+    frame_hook_t clock_hook;
+    std::function<void(timespec*)> real_clock;
+    int64_t last_predicted = 0;
+    uint64_t clock_frames = 0, clock_errors = 0, frames_with_hook = 0;
+
+    /* the gl_error_check option, while the gl_error_check scenario changes it */
+    bool saved_error_check = false;
+
+    signal_callback_t frame_done = [=] (signal_data *data)
+    {
+        auto frame = static_cast<frame_done_signal*> (data);
+        paint.record(frame->paint_time);
+        missed_deadlines += frame->missed_deadline;
+    };
+
+    public:
+    void init(wayfire_config *config)
+    {
+        if (core->get_next_output(output) != output)
+            return;
+
+        seat = core->get_current_seat();
+        if (!seat || !weston_seat_get_keyboard(seat) || !weston_seat_get_pointer(seat))
+        {
+            errio << "bench: no seat to send input, use the headless backend" << std::endl;
+            return;
+        }
+
+        this->config = config;
+        auto section = config->get_section("bench");
+
+        client = section->get_string("client", "wayfire-bench --client");
+        results_file = section->get_string("results", "");
+        windows = section->get_int("windows", 200);
+        scenario_duration = section->get_duration("scenario_duration", 3000);
+
+        std::istringstream scenarios(section->get_string("scenarios",
+                    "windows expo cube switcher gl_error_check frame_clock"));
+
+        std::string name;
+        while (scenarios >> name)
+            add_scenario(name);
+
+        add_step(0, [=] () { finish(); });
+
+        auto loop = wl_display_get_event_loop(core->ec->wl_display);
+        timer = wl_event_loop_add_timer(loop, handle_timer, this);
+        /* give the other plugins and outputs time to start */
+        wl_event_source_timer_update(timer, 1000);
+    }
+
+    void add_step(int delay, std::function<void()> action,
+            std::function<bool()> done = nullptr)
+    {
+        steps.push_back({delay, action, done});
+    }
+
+    static int handle_timer(void *data)
+    {
+        auto bench = (wayfire_bench*) data;
+        bench->run_step();
+        return 0;
+    }
+
+    void run_step()
+    {
+        if (current_step >= steps.size())
+            return;
+
+        auto& current = steps[current_step];
+        if (current.action)
+            current.action();
+
+        /* waiting steps poll without an action, after the first time */
+        if (current.done && !current.done())
+        {
+            current.action = nullptr;
+            current.delay = 100;
+        } else
+        {
+            ++current_step;
+        }
+
+        if (current_step < steps.size())
+            wl_event_source_timer_update(timer, std::max(1, steps[current_step].delay));
+    }
+
+    void send_key(uint32_t key, bool pressed)
+    {
+        notify_key(seat, weston_compositor_get_time(), key,
+                pressed ? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED,
+                STATE_UPDATE_AUTOMATIC);
+    }
+
+    void send_mods(uint32_t mods, bool pressed)
+    {
+        static const std::pair<uint32_t, uint32_t> modifier_keys[] = {
+            {MODIFIER_CTRL, KEY_LEFTCTRL}, {MODIFIER_ALT, KEY_LEFTALT},
+            {MODIFIER_SUPER, KEY_LEFTMETA}, {MODIFIER_SHIFT, KEY_LEFTSHIFT}
+        };
+
+        for (auto& mod : modifier_keys)
+        {
+            if (mods & mod.first)
+                send_key(mod.second, pressed);
+        }
+    }
+
+    void tap_key(wayfire_key key)
+    {
+        send_mods(key.mod, true);
+        send_key(key.keyval, true);
+        send_key(key.keyval, false);
+        send_mods(key.mod, false);
+    }
+
+    void send_button(uint32_t button, bool pressed)
+    {
+        notify_button(seat, weston_compositor_get_time(), button,
+                pressed ? WL_POINTER_BUTTON_STATE_PRESSED : WL_POINTER_BUTTON_STATE_RELEASED);
+    }
+
+    void move_pointer(double dx, double dy)
+    {
+        weston_pointer_motion_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+
+        ev.mask = WESTON_POINTER_MOTION_REL;
+        ev.dx = dx;
+        ev.dy = dy;
+
+        notify_motion(seat, weston_compositor_get_time(), &ev);
+    }
+
+    int count_views()
+    {
+        int count = 0;
+        core->for_each_output([&] (wayfire_output *wo)
+        {
+            wo->workspace->for_each_view([&] (wayfire_view) { ++count; });
+        });
+
+        return count;
+    }
+
+    void add_scenario(const std::string& name)
+    {
+        /* without the gl-renderer(e.g libweston-3's headless backend uses pixman)
+         * plugin renderers and effects don't run, so there is nothing to measure */
+        bool needs_gl = (name == "expo" || name == "cube" ||
+                name == "switcher" || name == "gl_error_check");
+        if (needs_gl && !render_manager::renderer_api)
+        {
+            errio << "bench: skipping " << name << ", it requires GL" << std::endl;
+            add_step(0, [=] () {
+                results.push_back("\"" + name + "\": {\"skipped\": \"requires GL\"}");
+            });
+
+            return;
+        }
+
+        if (name == "gl_error_check")
+        {
+            add_error_check_scenarios();
+            return;
+        }
+
+        add_step(0, [=] () { begin_scenario(name); });
+
+        if (name == "windows")
+        {
+            add_step(0, [=] () {
+                core->run((client + " " + std::to_string(windows)).c_str());
+            });
+
+            /* wait for the clients to map, but not forever */
+            auto start = std::make_shared<uint32_t>(0);
+            add_step(100, [=] () { *start = weston_compositor_get_time(); }, [=] () {
+                return count_views() >= windows ||
+                    weston_compositor_get_time() - *start > 30000;
+            });
+
+            add_step(scenario_duration, nullptr);
+        } else if (name == "expo")
+        {
+            add_expo_steps();
+        } else if (name == "cube")
+        {
+            auto activate = config->get_section("cube")->get_button("activate",
+                    {MODIFIER_ALT | MODIFIER_CTRL, BTN_LEFT});
+
+            add_step(0, [=] () {
+                send_mods(activate.mod, true);
+                send_button(activate.button, true);
+            });
+
+            /* spin with a drag of one step per 60Hz frame */
+            const int motion_interval = 16;
+            for (int i = 0; i < scenario_duration / motion_interval; i++)
+                add_step(motion_interval, [=] () { move_pointer(8, 0); });
+
+            add_step(motion_interval, [=] () {
+                send_button(activate.button, false);
+                send_mods(activate.mod, false);
+            });
+        } else if (name == "switcher")
+        {
+            auto section = config->get_section("switcher");
+            auto activate = section->get_key("activate", {MODIFIER_ALT, KEY_TAB});
+            auto next = section->get_key("next", {0, KEY_RIGHT});
+            auto exit_key = section->get_key("exit", {0, KEY_ENTER});
+
+            /* the modifier is held during the whole cycle */
+            add_step(0, [=] () {
+                send_mods(activate.mod, true);
+                send_key(activate.keyval, true);
+                send_key(activate.keyval, false);
+            });
+
+            const int cycles = 8;
+            for (int i = 0; i < cycles; i++)
+                add_step(scenario_duration / (cycles + 1), [=] () { tap_key(next); });
+
+            add_step(scenario_duration / (cycles + 1), [=] () {
+                tap_key(exit_key);
+                send_mods(activate.mod, false);
+            });
+        } else if (name == "frame_clock")
+        {
+            add_step(0, [=] () { start_clock_check(); });
+            add_step(scenario_duration, [=] () { stop_clock_check(); });
+            /* without the hook nothing animates, so the output should go idle */
+            add_step(500, nullptr);
+        } else
+        {
+            errio << "bench: unknown scenario " << name << std::endl;
+        }
+
+        add_step(0, [=] () { end_scenario(); });
+    }
+
+    void add_expo_steps()
+    {
+        auto toggle = config->get_section("expo")->get_key("toggle",
+                {MODIFIER_SUPER, KEY_E});
+
+        add_step(0, [=] () { tap_key(toggle); });
+        add_step(scenario_duration / 2, [=] () { tap_key(toggle); });
+        add_step(scenario_duration / 2, nullptr);
+    }
+
+    /* The expo scenario, first without checking GL errors and then with
+     * the check once per frame, as "gl_error_check/none" and "/frame".
+     * Debug builds check after each call anyway, their results (see
+     * "debug_build") are the cost of that */
+    void add_error_check_scenarios()
+    {
+        for (bool check : {false, true})
+        {
+            std::string name = std::string("gl_error_check/") + (check ? "frame" : "none");
+            add_step(0, [=] () {
+                saved_error_check = OpenGL::frame_error_check;
+                OpenGL::frame_error_check = check;
+                begin_scenario(name);
+            });
+
+            add_expo_steps();
+
+            add_step(0, [=] () {
+                end_scenario();
+                OpenGL::frame_error_check = saved_error_check;
+            });
+        }
+    }
+
+    static int64_t to_ns(const timespec& ts)
+    {
+        return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    }
+
+    void start_clock_check()
+    {
+        real_clock = render_manager::frame_clock;
+        render_manager::frame_clock = [=] (timespec *ts)
+        {
+            real_clock(ts);
+            ts->tv_sec += 24 * 60 * 60;
+        };
+
+        last_predicted = 0;
+        clock_frames = clock_errors = 0;
+        clock_hook = [=] (const timespec& predicted)
+        {
+            timespec now;
+            render_manager::frame_clock(&now);
+
+            int64_t ahead = to_ns(predicted) - to_ns(now);
+            /* the presentation time may be rounded to milliseconds */
+            int64_t max_ahead = output->render->get_refresh_ns() + 1000000;
+
+            if (ahead <= 0 || ahead > max_ahead || to_ns(predicted) <= last_predicted)
+            {
+                errio << "bench: frame predicted " << ahead / 1000
+                    << "us ahead, " << (to_ns(predicted) - last_predicted) / 1000
+                    << "us after the previous one" << std::endl;
+                ++clock_errors;
+            }
+
+            last_predicted = to_ns(predicted);
+            ++clock_frames;
+        };
+
+        output->render->add_frame_hook(&clock_hook);
+    }
+
+    void stop_clock_check()
+    {
+        output->render->rem_frame_hook(&clock_hook);
+        render_manager::frame_clock = real_clock;
+        real_clock = nullptr;
+        frames_with_hook = paint.count;
+    }
+
+    void begin_scenario(const std::string& name)
+    {
+        scenario = name;
+        paint = wf_histogram();
+        missed_deadlines = 0;
+        details.clear();
+
+        core->for_each_output([=] (wayfire_output *wo) {
+            wo->signal->connect<wf_signal::frame_done>(&frame_done);
+            weston_output_schedule_repaint(wo->handle);
+        });
+    }
+
+    void end_scenario()
+    {
+        core->for_each_output([=] (wayfire_output *wo) {
+            wo->signal->disconnect<wf_signal::frame_done>(&frame_done);
+        });
+
+        paint.end_window();
+
+        if (scenario == "frame_clock")
+        {
+            details = ", \"hook_frames\": " + std::to_string(clock_frames) +
+                ", \"prediction_errors\": " + std::to_string(clock_errors) +
+                ", \"idle_frames\": " + std::to_string(paint.count - frames_with_hook);
+        }
+
+        std::ostringstream out;
+        out << "\"" << scenario << "\": {\"frames\": " << paint.count
+            << ", \"missed_deadlines\": " << missed_deadlines
+            << ", \"paint_us\": {\"mean\": " << (paint.count ? paint.sum / paint.count : 0)
+            << ", \"p50\": " << paint.quantile(0.5)
+            << ", \"p90\": " << paint.quantile(0.9)
+            << ", \"p99\": " << paint.quantile(0.99)
+            << ", \"p999\": " << paint.quantile(0.999) << "}" << details << "}";
+
+        results.push_back(out.str());
+    }
+
+    void finish()
+    {
+        int outputs = 0;
+        core->for_each_output([&] (wayfire_output *) { ++outputs; });
+
+        std::ostringstream out;
+        out << "{\"outputs\": " << outputs << ", \"windows\": " << windows
+            << ", \"renderer\": \"" << (render_manager::renderer_api ? "gl" : "pixman")
+            << "\", \"debug_build\": " << (WAYFIRE_DEBUG_ENABLED ? "true" : "false")
+            << ", \"scenarios\": {";
+        for (size_t i = 0; i < results.size(); i++)
+            out << (i ? ", " : "") << results[i];
+        out << "}}\n";
+
+        if (results_file.empty())
+        {
+            info << "bench: " << out.str();
+        } else
+        {
+            std::ofstream file(results_file);
+            file << out.str();
+        }
+
+        wl_display_terminate(core->ec->wl_display);
+    }
+
+    void fini()
+    {
+        if (!timer)
+            return;
+
+        wl_event_source_remove(timer);
+        if (real_clock)
+            stop_clock_check();
+
+        core->for_each_output([=] (wayfire_output *wo) {
+            wo->signal->disconnect<wf_signal::frame_done>(&frame_done);
+        });
+    }
+};
+
+extern "C"
+{
+    wayfire_plugin_t *newInstance()
+    {
+        return new wayfire_bench();
+    }
+}
@@ -16,7 +16,7 @@ class wayfire_expo : public wayfire_plugin_t {
 
         wayfire_color background_color;
 
-        int max_steps;
+        wf_duration duration;
 
         render_hook_t renderer;
 
@@ -28,11 +28,15 @@ class wayfire_expo : public wayfire_plugin_t {
 
             int zoom_delta = 1;
         } state;
+
+        /* linear position of the zoom, from 0(zoomed in) to 1(the overview).
+         * It is eased as a whole, so zooming out runs the curve of zooming in
+         * backwards, and a toggle during a zoom continues from where it is */
+        float zoom_position = 0, zoom_start_position = 0;
         int target_vx, target_vy;
         std::tuple<int, int> move_started_ws;
 
         std::vector<std::vector<wf_workspace_stream*>> streams;
-        signal_callback_t resized_cb;
 
         int delimiter_offset;
 
@@ -48,33 +52,30 @@ class wayfire_expo : public wayfire_plugin_t {
         if (!toggle_key.keyval || !toggle_key.mod)
             return;
 
+        /* thumbnails are opaque, so 16-bit textures are usually good enough */
+        bool rgb565_thumbnails =
+            section->get_string("thumbnail_format", "rgba") == "rgb565";
+
         GetTuple(vw, vh, output->workspace->get_workspace_grid_size());
         streams.resize(vw);
 
         for (int i = 0; i < vw; i++) {
             for (int j = 0;j < vh; j++) {
                 streams[i].push_back(new wf_workspace_stream);
-                streams[i][j]->tex = streams[i][j]->fbuff = -1;
+                streams[i][j]->rgb565 = rgb565_thumbnails;
                 streams[i][j]->ws = std::make_tuple(i, j);
             }
         }
 
-        max_steps = section->get_duration("duration", 20);
+        duration = wf_duration(section->get_duration("duration", 320), wf_easing::linear);
         delimiter_offset = section->get_int("offset", 10);
 
         toggle_cb = [=] (weston_keyboard *kbd, uint32_t key) {
-            if (!state.active) {
-                activate();
-            } else {
-                deactivate();
-            }
+            toggle();
         };
 
         touch_toggle_cb = [=] (wayfire_touch_gesture*) {
-            if (state.active)
-                deactivate();
-            else
-                activate();
+            toggle();
         };
 
         output->add_key(toggle_key.mod, toggle_key.keyval, &toggle_cb);
@@ -128,21 +129,26 @@ class wayfire_expo : public wayfire_plugin_t {
 
         renderer = std::bind(std::mem_fn(&wayfire_expo::render), this);
 
-        resized_cb = [=] (signal_data*) {
-            for (int i = 0; i < vw; i++) {
-                for (int j = 0; j < vh; j++) {
-                    GL_CALL(glDeleteTextures(1, &streams[i][j]->tex));
-                    GL_CALL(glDeleteFramebuffers(1, &streams[i][j]->fbuff));
-                    streams[i][j]->tex = streams[i][j]->fbuff = -1;
-                }
-            }
-        };
-
-        output->signal->connect_signal("output-resized", &resized_cb);
-
         background_color = section->get_color("background", {0, 0, 0, 1});
     }
 
+    void toggle()
+    {
+        if (!state.active)
+        {
+            activate();
+        } else if (state.zoom_delta == -1)
+        {
+            /* still zooming out, go back to the overview */
+            state.in_zoom = true;
+            state.zoom_delta = 1;
+            calculate_zoom(true);
+        } else
+        {
+            deactivate();
+        }
+    }
+
     void activate()
     {
         if (!output->activate_plugin(grab_interface))
@@ -285,13 +291,7 @@ class wayfire_expo : public wayfire_plugin_t {
         sx -= vx * og.width;
         sy -= vy * og.height;
 
-        wayfire_view search = nullptr;
-        output->workspace->for_each_view([&search, og, sx, sy] (wayfire_view v) {
-            if (!search && point_inside({sx + og.x, sy + og.y}, v->geometry))
-            search = v;
-        });
-
-        return search;
+        return output->workspace->get_view_at_point(sx + og.x, sy + og.y);
     }
 
     void update_target_workspace(int x, int y) {
@@ -366,7 +366,8 @@ class wayfire_expo : public wayfire_plugin_t {
         for(int j = 0; j < vh; j++) {
             for(int i = 0; i < vw; i++) {
                 if (!streams[i][j]->running) {
-                    output->render->workspace_stream_start(streams[i][j]);
+                    output->render->workspace_stream_start(streams[i][j],
+                            render_params.scale_x, render_params.scale_y);
                 } else {
                     output->render->workspace_stream_update(streams[i][j],
                             render_params.scale_x, render_params.scale_y);
@@ -382,14 +383,14 @@ class wayfire_expo : public wayfire_plugin_t {
                 OpenGL::texture_geometry texg;
                 texg.x1 = 0;
                 texg.y1 = 0;
-                texg.x2 = streams[i][j]->scale_x;
-                texg.y2 = streams[i][j]->scale_y;
+                texg.x2 = streams[i][j]->tex_x2;
+                texg.y2 = streams[i][j]->tex_y2;
 
                 GL_CALL(glEnable(GL_SCISSOR_TEST));
                 GL_CALL(glScissor(0, 0, output->render->ctx->device_width,
                             output->render->ctx->device_height));
 
-                OpenGL::render_transformed_texture(streams[i][j]->tex, g, texg, matrix,
+                OpenGL::render_transformed_texture(streams[i][j]->buffer.tex, g, texg, matrix,
                         glm::vec4(1), TEXTURE_TRANSFORM_USE_DEVCOORD | TEXTURE_TRANSFORM_INVERT_Y |
                         TEXTURE_USE_TEX_GEOMETRY);
 
@@ -406,7 +407,6 @@ class wayfire_expo : public wayfire_plugin_t {
     };
 
     struct {
-        int steps = 0;
         tup scale_x, scale_y,
             off_x, off_y;
     } zoom_target;
@@ -425,14 +425,8 @@ class wayfire_expo : public wayfire_plugin_t {
         float center_w = vw / 2.f;
         float center_h = vh / 2.f;
 
-        if (zoom_in) {
-            zoom_target.steps = 0;
-            render_params.scale_x = render_params.scale_y = 1;
-        } else {
-            zoom_target.steps = max_steps;
-            render_params.scale_x = 1.f / vw;
-            render_params.scale_y = 1.f / vh;
-        }
+        duration.start();
+        zoom_start_position = zoom_position;
 
         float mf_x = 2. * delimiter_offset / output->handle->width;
         float mf_y = 2. * delimiter_offset / output->handle->height;
@@ -442,26 +436,39 @@ class wayfire_expo : public wayfire_plugin_t {
 
         zoom_target.off_x   = {-mf_x, ((target_vx - center_w) * 2.f + 1.f) / vw + diff_w};
         zoom_target.off_y   = { mf_y, ((center_h - target_vy) * 2.f - 1.f) / vh - diff_h};
+        apply_zoom();
+    }
+
+    void apply_zoom()
+    {
+        float progress = wf_easing::sine_out(zoom_position);
+        auto interpolate = [=] (const tup& t)
+        {
+            return progress * t.end + (1 - progress) * t.begin;
+        };
+
+        render_params.scale_x = interpolate(zoom_target.scale_x);
+        render_params.scale_y = interpolate(zoom_target.scale_y);
+        render_params.off_x = interpolate(zoom_target.off_x);
+        render_params.off_y = interpolate(zoom_target.off_y);
     }
 
     void update_zoom()
     {
-        render_params.scale_x = GetProgress(zoom_target.scale_x.begin,
-                zoom_target.scale_x.end, zoom_target.steps, max_steps);
-        render_params.scale_y = GetProgress(zoom_target.scale_y.begin,
-                zoom_target.scale_y.end, zoom_target.steps, max_steps);
-        render_params.off_x = GetProgress(zoom_target.off_x.begin,
-                zoom_target.off_x.end, zoom_target.steps, max_steps);
-        render_params.off_y = GetProgress(zoom_target.off_y.begin,
-                zoom_target.off_y.end, zoom_target.steps, max_steps);
-
-        zoom_target.steps += state.zoom_delta;
-
-        if (zoom_target.steps == max_steps + 1 && state.zoom_delta == 1) {
-            state.in_zoom = false;
-        } else if (state.zoom_delta == -1 && zoom_target.steps == -1) {
+        /* the duration is linear, it is the time since the zoom started */
+        float elapsed = duration.progress();
+        if (state.zoom_delta == 1)
+            zoom_position = std::min(1.f, zoom_start_position + elapsed);
+        else
+            zoom_position = std::max(0.f, zoom_start_position - elapsed);
+
+        apply_zoom();
+
+        bool done = (state.zoom_delta == 1) ? zoom_position >= 1 : zoom_position <= 0;
+        if (done) {
             state.in_zoom = false;
-            finalize_and_exit();
+            if (state.zoom_delta == -1)
+                finalize_and_exit();
         }
     }
 
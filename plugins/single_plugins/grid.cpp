@@ -41,7 +41,7 @@ class wayfire_grid : public wayfire_plugin_t {
         wayfire_view view;
     } current_view;
 
-    int total_steps, current_step;
+    wf_duration duration;
 
     public:
     void init(wayfire_config *config)
@@ -50,7 +50,7 @@ class wayfire_grid : public wayfire_plugin_t {
         grab_interface->abilities_mask = WF_ABILITY_CHANGE_VIEW_GEOMETRY;
 
         auto section = config->get_section("grid");
-        total_steps = section->get_duration("duration", 15);
+        duration = wf_duration(section->get_duration("duration", 240));
 
         for (int i = 1; i < 10; i++) {
             keys[i] = section->get_key("slot_" + slots[i], default_keys[i]);
@@ -119,7 +119,7 @@ class wayfire_grid : public wayfire_plugin_t {
 
         grab_interface->grab();
 
-        current_step = 0;
+        duration.start();
         current_view.view = view;
         current_view.original = view->geometry;
         current_view.target = {tx, ty, tw, th};
@@ -132,19 +132,18 @@ class wayfire_grid : public wayfire_plugin_t {
 
     void update_pos_size()
     {
-        int cx = GetProgress(current_view.original.x,
-                current_view.target.x, current_step, total_steps);
-        int cy = GetProgress(current_view.original.y,
-                current_view.target.y, current_step, total_steps);
-        int cw = GetProgress(current_view.original.width,
-                current_view.target.width, current_step, total_steps);
-        int ch = GetProgress(current_view.original.height,
-                current_view.target.height, current_step, total_steps);
+        int cx = duration.progress(current_view.original.x,
+                current_view.target.x);
+        int cy = duration.progress(current_view.original.y,
+                current_view.target.y);
+        int cw = duration.progress(current_view.original.width,
+                current_view.target.width);
+        int ch = duration.progress(current_view.original.height,
+                current_view.target.height);
 
         current_view.view->set_geometry(cx, cy, cw, ch);
 
-        current_step++;
-        if (current_step == total_steps)
+        if (!duration.running())
         {
             current_view.view->set_geometry(current_view.target);
             weston_desktop_surface_set_resizing(current_view.view->desktop_surface, false);
@@ -89,7 +89,8 @@ class view_switcher : public wayfire_plugin_t
 
     size_t current_view_index;
 
-    int max_steps, current_step, initial_animation_steps;
+    /* folding is the initial animation */
+    wf_duration duration, fold_duration;
 
     struct
     {
@@ -123,8 +124,8 @@ class view_switcher : public wayfire_plugin_t
         if (fast_switch_key.keyval)
             output->add_key(fast_switch_key.mod, fast_switch_key.keyval, &fast_switch_binding);
 
-        max_steps = section->get_duration("duration", 30);
-        initial_animation_steps = section->get_duration("initial_animation", 5);;
+        duration = wf_duration(section->get_duration("duration", 480));
+        fold_duration = wf_duration(section->get_duration("initial_animation", 80));
         view_scale_config = section->get_double("view_thumbnail_size", 0.4);
 
         activate_key = section->get_key("activate", {MODIFIER_ALT, KEY_TAB});
@@ -370,7 +371,7 @@ class view_switcher : public wayfire_plugin_t
         GetTuple(sw, sh, output->get_screen_size());
         active_views.clear();
         state.in_fold = true;
-        current_step = 0;
+        fold_duration.start();
 
         update_views();
         for (size_t i = current_view_index, cnt = 0; cnt < views.size(); ++cnt, i = (i + 1) % views.size())
@@ -405,28 +406,34 @@ class view_switcher : public wayfire_plugin_t
         }
     }
 
-    void update_view_transforms(int step, int maxstep)
+    void update_view_transforms(wf_duration& animation)
     {
+        float progress = animation.progress();
+        auto interpolate = [=] (float start, float end)
+        {
+            return progress * end + (1 - progress) * start;
+        };
+
         for (auto v : active_views)
         {
             if (v.updates & UPDATE_OFFSET)
             {
                 v.view->transform.translation = glm::translate(glm::mat4(), glm::vec3(
-                            GetProgress(v.off_x.start, v.off_x.end, step, maxstep),
-                            GetProgress(v.off_y.start, v.off_y.end, step, maxstep),
-                            GetProgress(v.off_z.start, v.off_z.end, step, maxstep)));
+                            interpolate(v.off_x.start, v.off_x.end),
+                            interpolate(v.off_y.start, v.off_y.end),
+                            interpolate(v.off_z.start, v.off_z.end)));
             }
             if (v.updates & UPDATE_SCALE)
             {
                 v.view->transform.scale = glm::scale(glm::mat4(), glm::vec3(
-                            GetProgress(v.scale_x.start, v.scale_x.end, step, maxstep),
-                            GetProgress(v.scale_y.start, v.scale_y.end, step, maxstep),
+                            interpolate(v.scale_x.start, v.scale_x.end),
+                            interpolate(v.scale_y.start, v.scale_y.end),
                             1));
             }
             if (v.updates & UPDATE_ROTATION)
             {
                 v.view->transform.rotation = glm::rotate(glm::mat4(),
-                        GetProgress(v.rot.start, v.rot.end, step, maxstep),
+                        interpolate(v.rot.start, v.rot.end),
                         glm::vec3(0, 1, 0));
             }
         }
@@ -452,10 +459,9 @@ class view_switcher : public wayfire_plugin_t
 
     void update_fold()
     {
-        ++current_step;
-        update_view_transforms(current_step, initial_animation_steps);
+        update_view_transforms(fold_duration);
 
-        if(current_step == initial_animation_steps)
+        if (!fold_duration.running())
         {
             for (auto &v : active_views)
                 v.view->transform.translation = glm::mat4();
@@ -476,7 +482,7 @@ class view_switcher : public wayfire_plugin_t
     void start_unfold()
     {
         state.in_unfold = true;
-        current_step = 0;
+        duration.start();
 
         active_views.clear();
 
@@ -536,10 +542,9 @@ class view_switcher : public wayfire_plugin_t
 
     void update_unfold()
     {
-        ++current_step;
-        update_view_transforms(current_step, max_steps);
+        update_view_transforms(duration);
 
-        if (current_step == max_steps)
+        if (!duration.running())
         {
             state.in_unfold = false;
             if (!state.reversed_folds)
@@ -560,7 +565,7 @@ class view_switcher : public wayfire_plugin_t
             return;
 
         state.in_rotate = true;
-        current_step = 0;
+        duration.start();
 
         /* TODO: whap happens if view gets destroyed? */
         current_view_index    = (current_view_index + dir + sz) % sz;
@@ -626,16 +631,13 @@ class view_switcher : public wayfire_plugin_t
             elem.off_y = {0, 0};
             elem.updates = UPDATE_ROTATION | UPDATE_OFFSET;
         }
-
-        current_step = 0;
     }
 
     void update_rotate()
     {
-        ++current_step;
-        update_view_transforms(current_step, max_steps);
+        update_view_transforms(duration);
 
-        if (current_step == max_steps)
+        if (!duration.running())
         {
             state.in_rotate = false;
             dequeue_next_action();
@@ -31,7 +31,7 @@ class vswitch : public wayfire_plugin_t
         touch_gesture_callback gesture_cb;
 
         std::queue<switch_direction> dirs; // series of moves we have to do
-        int current_step = 0, max_step;
+        wf_duration duration;
         bool running = false;
         effect_hook_t hook;
     public:
@@ -111,7 +111,7 @@ class vswitch : public wayfire_plugin_t
         };
         output->add_gesture(activation_gesture, &gesture_cb);
 
-        max_step = section->get_duration("duration", 15);
+        duration = wf_duration(section->get_duration("duration", 240));
         hook = std::bind(std::mem_fn(&vswitch::slide_update), this);
     }
 
@@ -138,15 +138,14 @@ class vswitch : public wayfire_plugin_t
 
     void slide_update()
     {
-        ++current_step;
-        float dx = GetProgress(sx, tx, current_step, max_step);
-        float dy = GetProgress(sy, ty, current_step, max_step);
+        float dx = duration.progress(sx, tx);
+        float dy = duration.progress(sy, ty);
 
         /* XXX: Possibly apply transform in custom rendering? */
         for (auto v : views)
             v.v->move(v.ox + dx, v.oy + dy);
 
-        if (current_step == max_step)
+        if (!duration.running())
             slide_done();
     }
 
@@ -190,7 +189,7 @@ class vswitch : public wayfire_plugin_t
             return;
         }
 
-        current_step = 0;
+        duration.start();
         dx = dirs.front().dx, dy = dirs.front().dy;
         wayfire_view static_view = front.view;
 
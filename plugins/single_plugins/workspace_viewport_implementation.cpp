@@ -3,6 +3,8 @@
 #include <signal_definitions.hpp>
 #include <pixman-1/pixman.h>
 #include <opengl.hpp>
+#include <unordered_map>
+#include <algorithm>
 
 struct wf_default_workspace_implementation : wf_workspace_implementation
 {
@@ -31,11 +33,66 @@ class viewport_manager : public workspace_manager
 
         wf_default_workspace_implementation default_implementation;
 
+        /* Spatial index of the views in the normal layer: a grid with one cell
+         * per workspace, where each view is registered in all cells it touches.
+         * Switching workspaces moves the views together with the grid origin,
+         * so their cells stay the same and the index needn't be updated */
+        struct view_index_entry
+        {
+            int x1, y1, x2, y2;
+            /* views with bigger serial are higher in the stack */
+            uint64_t serial;
+        };
+
+        /* Each cell also caches the list of views on its workspace, sorted from
+         * top to bottom, and the list used to render the workspace. They are
+         * rebuilt lazily after a view in the cell is moved, restacked, added or
+         * removed, so repeated queries from the renderer don't cost anything.
+         * Visibility isn't cached, as nothing tells us when it changes */
+        struct workspace_cell
+        {
+            std::vector<wayfire_view> views;
+
+            bool dirty = true;
+            std::vector<wayfire_view> stack;
+            /* fullscreen views in stack, set_fullscreen() invalidates the cells */
+            int fullscreen_count = 0;
+
+            bool renderable_dirty = true;
+            std::vector<wayfire_view> renderable;
+        };
+
+        std::unordered_map<wayfire_view, view_index_entry> view_index;
+        std::vector<workspace_cell> cells;
+        uint64_t stack_serial = 0;
+        bool switching_workspace = false;
+
+        /* set_workspace() moves most views only lazily, they are all synced
+         * with libweston from an idle callback, before the next repaint */
+        wl_event_source *sync_idle = nullptr;
+        static void sync_positions_idle(void *data);
+
+        /* output geometry the index was built for */
+        weston_geometry index_geometry;
+
+        void get_cell_range(weston_geometry g, int& x1, int& y1, int& x2, int& y2);
+        void index_view(wayfire_view view);
+        void unindex_view(wayfire_view view);
+        void check_index_geometry();
+
+        void invalidate_cells(int x1, int y1, int x2, int y2);
+        /* panels, the background or the current workspace have changed */
+        void invalidate_renderable();
+
+        /* up-to-date cell of the given workspace */
+        workspace_cell& get_cell(std::tuple<int, int> ws);
+
     public:
         void init(wayfire_output *output);
 
         void view_bring_to_front(wayfire_view view);
         void view_removed(wayfire_view view);
+        void view_geometry_changed(wayfire_view view);
 
         bool view_visible_on(wayfire_view, std::tuple<int, int>);
 
@@ -46,8 +103,11 @@ class viewport_manager : public workspace_manager
         bool set_implementation(std::tuple<int, int>, wf_workspace_implementation*, bool override = false);
 
         std::vector<wayfire_view> get_views_on_workspace(std::tuple<int, int>);
+        wayfire_view get_view_at_point(int x, int y);
         std::vector<wayfire_view>
         get_renderable_views_on_workspace(std::tuple<int, int> ws);
+        void get_renderable_views_on_workspace(std::tuple<int, int> ws,
+                std::vector<wayfire_view>& views);
 
         void set_workspace(std::tuple<int, int>);
 
@@ -86,6 +146,9 @@ void viewport_manager::init(wayfire_output *o)
     implementation.resize(vwidth, std::vector<wf_workspace_implementation*>
             (vheight, &default_implementation));
 
+    cells.resize(vwidth * vheight);
+    index_geometry = output->get_full_geometry();
+
     adjust_fullscreen_layer = [=] (signal_data *data)
     {
         auto conv = static_cast<view_maximized_signal*> (data);
@@ -101,16 +164,19 @@ void viewport_manager::init(wayfire_output *o)
     {
         check_lower_panel_layer(0);
     };
-    o->signal->connect_signal("view-fullscreen-request", &adjust_fullscreen_layer);
-    o->signal->connect_signal("attach-view", &view_detached);
-    o->signal->connect_signal("detach-view", &view_detached);
+    o->signal->connect<wf_signal::view_fullscreen_request>(&adjust_fullscreen_layer);
+    o->signal->connect<wf_signal::attach_view>(&view_detached);
+    o->signal->connect<wf_signal::detach_view>(&view_detached);
 }
 
 void viewport_manager::view_bring_to_front(wayfire_view view)
 {
     debug << "view bring_to_front" << view->desktop_surface << std::endl;
     if (view->handle->layer_link.layer == NULL)
+    {
         weston_layer_entry_insert(&normal_layer.view_list, &view->handle->layer_link);
+        index_view(view);
+    }
 }
 
 void viewport_manager::view_removed(wayfire_view view)
@@ -119,10 +185,258 @@ void viewport_manager::view_removed(wayfire_view view)
     if (view->handle->layer_link.layer)
         weston_layer_entry_remove(&view->handle->layer_link);
 
+    if (view_index.count(view))
+        unindex_view(view);
+    else
+        invalidate_renderable();
+
     if (view == background)
         background = nullptr;
 }
 
+void viewport_manager::view_geometry_changed(wayfire_view view)
+{
+    if (!view || switching_workspace)
+        return;
+
+    auto it = view_index.find(view);
+    if (it == view_index.end())
+    {
+        /* panels and background aren't in the index */
+        invalidate_renderable();
+        return;
+    }
+
+    check_index_geometry();
+
+    int x1, y1, x2, y2;
+    get_cell_range(view->geometry, x1, y1, x2, y2);
+
+    auto& e = it->second;
+    if (e.x1 == x1 && e.y1 == y1 && e.x2 == x2 && e.y2 == y2)
+    {
+        /* the view might have moved in or out of a workspace
+         * it only touched with its edge */
+        invalidate_cells(x1, y1, x2, y2);
+        return;
+    }
+
+    /* keep the stacking serial */
+    auto serial = e.serial;
+    unindex_view(view);
+    index_view(view);
+    view_index[view].serial = serial;
+}
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+void viewport_manager::get_cell_range(weston_geometry g, int& x1, int& y1, int& x2, int& y2)
+{
+    auto og = index_geometry;
+    if (og.width <= 0 || og.height <= 0)
+    {
+        x1 = y1 = x2 = y2 = 0;
+        return;
+    }
+
+    int64_t origin_x = og.x - (int64_t)vx * og.width;
+    int64_t origin_y = og.y - (int64_t)vy * og.height;
+
+    /* views which are outside of the grid are put in the border cells,
+     * queries always check the exact geometry anyway */
+    auto clamp = [] (int64_t v, int max) {
+        return (int)std::max((int64_t)0, std::min((int64_t)max - 1, v));
+    };
+
+    /* point_inside() includes the right and bottom edges, so do we */
+    x1 = clamp(floor_div(g.x - origin_x, og.width), vwidth);
+    y1 = clamp(floor_div(g.y - origin_y, og.height), vheight);
+    x2 = clamp(floor_div((int64_t)g.x + g.width - origin_x, og.width), vwidth);
+    y2 = clamp(floor_div((int64_t)g.y + g.height - origin_y, og.height), vheight);
+}
+
+void viewport_manager::index_view(wayfire_view view)
+{
+    if (view_index.count(view))
+        unindex_view(view);
+
+    check_index_geometry();
+
+    view_index_entry e;
+    get_cell_range(view->geometry, e.x1, e.y1, e.x2, e.y2);
+    e.serial = ++stack_serial;
+
+    for (int i = e.x1; i <= e.x2; i++)
+        for (int j = e.y1; j <= e.y2; j++)
+            cells[j * vwidth + i].views.push_back(view);
+
+    invalidate_cells(e.x1, e.y1, e.x2, e.y2);
+    view_index[view] = e;
+}
+
+void viewport_manager::unindex_view(wayfire_view view)
+{
+    auto it = view_index.find(view);
+    if (it == view_index.end())
+        return;
+
+    auto e = it->second;
+    for (int i = e.x1; i <= e.x2; i++)
+    {
+        for (int j = e.y1; j <= e.y2; j++)
+        {
+            auto& cell = cells[j * vwidth + i].views;
+            auto pos = std::find(cell.begin(), cell.end(), view);
+            if (pos != cell.end())
+            {
+                std::swap(*pos, cell.back());
+                cell.pop_back();
+            }
+        }
+    }
+
+    invalidate_cells(e.x1, e.y1, e.x2, e.y2);
+    view_index.erase(it);
+}
+
+/* the cells depend on the output size, so rebuild if it has changed */
+void viewport_manager::check_index_geometry()
+{
+    auto og = output->get_full_geometry();
+    if (og == index_geometry)
+        return;
+
+    index_geometry = og;
+    for (auto& cell : cells)
+    {
+        cell.views.clear();
+        cell.dirty = cell.renderable_dirty = true;
+    }
+
+    for (auto& kv : view_index)
+    {
+        auto& e = kv.second;
+        get_cell_range(kv.first->geometry, e.x1, e.y1, e.x2, e.y2);
+
+        for (int i = e.x1; i <= e.x2; i++)
+            for (int j = e.y1; j <= e.y2; j++)
+                cells[j * vwidth + i].views.push_back(kv.first);
+    }
+}
+
+void viewport_manager::invalidate_cells(int x1, int y1, int x2, int y2)
+{
+    for (int i = x1; i <= x2; i++)
+    {
+        for (int j = y1; j <= y2; j++)
+        {
+            auto& cell = cells[j * vwidth + i];
+            cell.dirty = cell.renderable_dirty = true;
+        }
+    }
+}
+
+void viewport_manager::invalidate_renderable()
+{
+    for (auto& cell : cells)
+        cell.renderable_dirty = true;
+}
+
+viewport_manager::workspace_cell& viewport_manager::get_cell(std::tuple<int, int> ws)
+{
+    check_index_geometry();
+
+    GetTuple(tx, ty, ws);
+    auto& cell = cells[ty * vwidth + tx];
+
+    if (cell.dirty)
+    {
+        weston_geometry g = output->get_full_geometry();
+        g.x += (tx - vx) * output->handle->width;
+        g.y += (ty - vy) * (output->handle->height);
+
+        std::vector<std::pair<uint64_t, wayfire_view>> found;
+        for (auto& view : cell.views)
+        {
+            if (rect_intersect(g, view->geometry))
+                found.push_back({view_index[view].serial, view});
+        }
+
+        std::sort(found.begin(), found.end(),
+                  [] (const std::pair<uint64_t, wayfire_view>& a,
+                      const std::pair<uint64_t, wayfire_view>& b)
+        {
+            return a.first > b.first;
+        });
+
+        cell.stack.clear();
+        cell.fullscreen_count = 0;
+        for (auto& f : found)
+        {
+            cell.stack.push_back(f.second);
+            cell.fullscreen_count += (f.second->fullscreen ? 1 : 0);
+        }
+
+        cell.dirty = false;
+    }
+
+    if (cell.renderable_dirty)
+    {
+        weston_geometry g = output->get_full_geometry();
+        cell.renderable.clear();
+
+        weston_view *view;
+        wayfire_view v;
+
+        if (tx == vx && ty == vy)
+        {
+            wl_list_for_each(view, &panel_layer.view_list.link, layer_link.link)
+            {
+                if ((v = core->find_view(view)) && rect_intersect(g, v->geometry))
+                    cell.renderable.push_back(v);
+            }
+        }
+
+        cell.renderable.insert(cell.renderable.end(), cell.stack.begin(), cell.stack.end());
+
+        auto bg = get_background_view();
+        if (bg) cell.renderable.push_back(bg);
+
+        cell.renderable_dirty = false;
+    }
+
+    return cell;
+}
+
+wayfire_view viewport_manager::get_view_at_point(int x, int y)
+{
+    check_index_geometry();
+
+    int cx, cy, unused_x, unused_y;
+    get_cell_range({x, y, 0, 0}, cx, cy, unused_x, unused_y);
+
+    wayfire_view chosen = nullptr;
+    uint64_t chosen_serial = 0;
+
+    for (auto& view : cells[cy * vwidth + cx].views)
+    {
+        if (!view->is_visible() || !point_inside({x, y}, view->geometry))
+            continue;
+
+        auto serial = view_index[view].serial;
+        if (!chosen || serial > chosen_serial)
+        {
+            chosen = view;
+            chosen_serial = serial;
+        }
+    }
+
+    return chosen;
+}
+
 bool viewport_manager::view_visible_on(wayfire_view view, std::tuple<int, int> vp)
 {
     GetTuple(tx, ty, vp);
@@ -190,19 +504,43 @@ void viewport_manager::set_workspace(std::tuple<int, int> nPos)
         return;
 
     if (nx == vx && ny == vy) {
-        auto views = get_views_on_workspace(std::make_tuple(vx, vy));
-        if (views.size() >= 1)
-            output->focus_view(views[0]);
+        wayfire_view top = nullptr;
+        for (auto& v : get_cell(nPos).stack)
+        {
+            if (v->is_visible())
+            {
+                top = v;
+                break;
+            }
+        }
+
+        if (top)
+            output->focus_view(top);
         return;
     }
 
     auto dx = (vx - nx) * output->handle->width;
     auto dy = (vy - ny) * output->handle->height;
 
-    for_each_view([=] (wayfire_view v) {
-        v->move(v->geometry.x + dx, v->geometry.y + dy);
-    });
+    /* Only the views visible before or after the switch have to be moved in
+     * libweston right away. All others just get their new geometry and are
+     * synced once the switching is done, so that several switches in a row
+     * send clients a single configure event */
+    switching_workspace = true;
+    for (auto& kv : view_index)
+    {
+        auto& v = kv.first;
+        v->move_lazy(v->geometry.x + dx, v->geometry.y + dy);
+    }
+    switching_workspace = false;
 
+    /* otherwise damage and the opaque regions of the views on other
+     * workspaces would stay at their old position, e.g in expo */
+    if (!sync_idle)
+    {
+        auto loop = wl_display_get_event_loop(core->ec->wl_display);
+        sync_idle = wl_event_loop_add_idle(loop, sync_positions_idle, this);
+    }
 
     weston_output_schedule_repaint(output->handle);
 
@@ -215,36 +553,59 @@ void viewport_manager::set_workspace(std::tuple<int, int> nPos)
 
     vx = nx;
     vy = ny;
-    output->signal->emit_signal("viewport-changed", &data);
+    /* panels are rendered only on the current workspace */
+    invalidate_renderable();
+
+    /* the views stay in their cells, so the cell of the old workspace
+     * still has the views which were visible before the switch */
+    for (auto& v : get_cell(std::make_tuple(data.old_vx, data.old_vy)).stack)
+        v->sync_position();
 
-    output->focus_view(nullptr);
-    /* we iterate through views on current viewport from bottom to top
-     * that way we ensure that they will be focused befor all others */
+    /* a copy, because bringing the views to front below changes the stack */
     auto views = get_views_on_workspace(std::make_tuple(vx, vy));
+    for (auto& v : views)
+        v->sync_position();
+
+    output->signal->emit<wf_signal::viewport_changed>(&data);
+
+    /* raise the views on the current viewport above all others, from bottom
+     * to top so that they keep their order, but activate only the topmost */
+    wayfire_view top = nullptr;
     auto it = views.rbegin();
     while(it != views.rend()) {
         if ((*it)->is_mapped && !(*it)->destroyed)
-            output->focus_view(*it);
+        {
+            output->bring_to_front(*it);
+            top = *it;
+        }
         ++it;
     }
 
+    output->focus_view(top);
+
     check_lower_panel_layer(0);
 }
 
-std::vector<wayfire_view> viewport_manager::get_views_on_workspace(std::tuple<int, int> vp)
+void viewport_manager::sync_positions_idle(void *data)
 {
-    GetTuple(tx, ty, vp);
+    auto manager = (viewport_manager*) data;
+    manager->sync_idle = nullptr;
 
-    weston_geometry g = output->get_full_geometry();
-    g.x += (tx - vx) * output->handle->width;
-    g.y += (ty - vy) * (output->handle->height);
+    for (auto& kv : manager->view_index)
+        kv.first->sync_position();
+}
+
+std::vector<wayfire_view> viewport_manager::get_views_on_workspace(std::tuple<int, int> vp)
+{
+    auto& stack = get_cell(vp).stack;
 
     std::vector<wayfire_view> ret;
-    for_each_view([&ret, g] (wayfire_view view) {
-        if (rect_intersect(g, view->geometry)) {
+    ret.reserve(stack.size());
+    for (auto& view : stack)
+    {
+        if (view->is_visible())
             ret.push_back(view);
-        }
-    });
+    }
 
     return ret;
 }
@@ -252,36 +613,14 @@ std::vector<wayfire_view> viewport_manager::get_views_on_workspace(std::tuple<in
 std::vector<wayfire_view> viewport_manager::get_renderable_views_on_workspace(
         std::tuple<int, int> ws)
 {
-    std::vector<wayfire_view> ret;
-    weston_view *view;
-    wayfire_view v;
-
-    GetTuple(tx, ty, ws);
-
-    weston_geometry g = output->get_full_geometry();
-    g.x += (tx - vx) * output->handle->width;
-    g.y += (ty - vy) * (output->handle->height);
-
-    if (tx == vx && ty == vy)
-    {
-        wl_list_for_each(view, &panel_layer.view_list.link, layer_link.link)
-        {
-            if ((v = core->find_view(view)) && rect_intersect(g, v->geometry))
-                ret.push_back(v);
-        }
-    }
-
-    wl_list_for_each(view, &normal_layer.view_list.link, layer_link.link)
-    {
-        if ((v = core->find_view(view)) && rect_intersect(g, v->geometry))
-            ret.push_back(v);
-    }
-
-    auto bg = get_background_view();
-    if (bg) ret.push_back(bg);
-
+    return get_cell(ws).renderable;
+}
 
-    return ret;
+void viewport_manager::get_renderable_views_on_workspace(std::tuple<int, int> ws,
+        std::vector<wayfire_view>& views)
+{
+    auto& renderable = get_cell(ws).renderable;
+    views.assign(renderable.begin(), renderable.end());
 }
 
 wayfire_view viewport_manager::get_background_view()
@@ -309,6 +648,7 @@ void viewport_manager::add_background(wayfire_view background, int x, int y)
     pixman_region32_copy(&background->handle->damage_clip_region, &output->handle->region);
 
     weston_layer_entry_insert(&background_layer.view_list, &background->handle->layer_link);
+    invalidate_renderable();
 
     auto loop = wl_display_get_event_loop(core->ec->wl_display);
     wl_event_loop_add_idle(loop, bg_idle_cb, output->handle);
@@ -327,6 +667,7 @@ void viewport_manager::add_panel(wayfire_view panel)
     pixman_region32_copy(&panel->handle->damage_clip_region, &output->handle->region);
 
     weston_layer_entry_insert(&panel_layer.view_list, &panel->handle->layer_link);
+    invalidate_renderable();
 }
 
 void viewport_manager::reserve_workarea(wayfire_shell_panel_position position,
@@ -356,7 +697,7 @@ void viewport_manager::reserve_workarea(wayfire_shell_panel_position position,
     data.width = width;
     data.height = height;
     data.position = position;
-    output->signal->emit_signal("reserved-workarea", &data);
+    output->signal->emit<wf_signal::reserved_workarea>(&data);
 }
 
 void viewport_manager::configure_panel(wayfire_view view, int x, int y)
@@ -379,11 +720,7 @@ weston_geometry viewport_manager::get_workarea()
 
 void viewport_manager::check_lower_panel_layer(int base)
 {
-    auto views = get_views_on_workspace(get_current_workspace());
-
-    int cnt_fullscreen = base;
-    for (auto v : views)
-        cnt_fullscreen += (v->fullscreen ? 1 : 0);
+    int cnt_fullscreen = base + get_cell(get_current_workspace()).fullscreen_count;
 
     if (cnt_fullscreen)
     {
@@ -0,0 +1,170 @@
+#include "window.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+wayfire_display display;
+
+/* wayfire-bench starts wayfire with the headless backend and the bench
+ * plugin, which runs the scenarios, and prints the results as JSON.
+ * With -n, wayfire runs nested in the current X11 or wayland session
+ * instead, so that it has the gl-renderer, which the GL scenarios need.
+ *
+ * wayfire-bench --client N is run by the bench plugin to open the windows */
+
+static int run_client(int count)
+{
+    if (!setup_wayland_connection())
+        return -1;
+
+    std::vector<wayfire_window*> windows;
+    for (int i = 0; i < count; i++)
+    {
+        auto window = create_window(320, 240);
+        if (!window)
+            break;
+
+        auto cr = cairo_create(window->cairo_surface);
+        cairo_set_source_rgb(cr, (i % 3) / 2.0, (i % 5) / 4.0, (i % 7) / 6.0);
+        cairo_paint(cr);
+        cairo_destroy(cr);
+
+        damage_commit_window(window);
+        windows.push_back(window);
+    }
+
+    /* the windows live until the compositor exits */
+    while (wl_display_dispatch(display.wl_disp) >= 0);
+
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat*, int, FTW*)
+{
+    return remove(path);
+}
+
+/* remove the directory with everything in it */
+static void remove_tree(const std::string& path)
+{
+    if (nftw(path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS) < 0)
+        std::cerr << "failed to remove " << path << std::endl;
+}
+
+static void usage(const char *name)
+{
+    std::cerr << "usage: " << name << " [-o outputs] [-w windows] [-s scenarios]"
+        " [-d scenario duration ms] [-c compositor] [-p plugin path prefix] [-n]\n"
+        "scenarios is a space separated list of: windows expo cube switcher"
+        " gl_error_check frame_clock"
+        << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && !std::strcmp(argv[1], "--client"))
+        return run_client(std::atoi(argv[2]));
+
+    int outputs = 1, windows = 200, duration = 3000;
+    std::string scenarios = "windows expo cube switcher gl_error_check frame_clock";
+    std::string compositor = "wayfire", plugin_path;
+    bool nested = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "o:w:s:d:c:p:nh")) != -1)
+    {
+        switch (c)
+        {
+            case 'o': outputs = std::atoi(optarg); break;
+            case 'w': windows = std::atoi(optarg); break;
+            case 's': scenarios = optarg; break;
+            case 'd': duration = std::atoi(optarg); break;
+            case 'c': compositor = optarg; break;
+            case 'p': plugin_path = optarg; break;
+            case 'n': nested = true; break;
+            default: usage(argv[0]); return -1;
+        }
+    }
+
+    /* the compositor gets its own home, so that the user's config isn't used */
+    char home[] = "/tmp/wayfire-bench-XXXXXX";
+    if (!mkdtemp(home))
+    {
+        std::cerr << "failed to create a temporary directory" << std::endl;
+        return -1;
+    }
+
+    std::string home_dir = home;
+    mkdir((home_dir + "/.config").c_str(), 0700);
+
+    std::string results = home_dir + "/results.json";
+    char client_path[PATH_MAX];
+    if (!realpath(argv[0], client_path))
+        std::strcpy(client_path, argv[0]);
+
+    std::ofstream config(home_dir + "/.config/wayfire.ini");
+    config << "[core]\n"
+        << "plugins = viewport_impl expo cube switcher bench\n"
+        << "run_panel = 0\n"
+        << "headless_outputs = " << outputs << "\n";
+    if (!plugin_path.empty())
+        config << "plugin_path_prefix = " << plugin_path << "\n";
+
+    config << "[bench]\n"
+        << "client = " << client_path << " --client\n"
+        << "windows = " << windows << "\n"
+        << "scenarios = " << scenarios << "\n"
+        << "scenario_duration = " << duration << "\n"
+        << "results = " << results << "\n";
+    config.close();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        setenv("HOME", home, 1);
+        if (!nested)
+        {
+            setenv("WAYFIRE_BACKEND", "headless", 1);
+            unsetenv("WAYLAND_DISPLAY");
+            unsetenv("DISPLAY");
+        }
+
+        std::string log = home_dir + "/wayfire.log";
+        execlp(compositor.c_str(), compositor.c_str(), log.c_str(), NULL);
+
+        std::cerr << "failed to run " << compositor << std::endl;
+        std::exit(-1);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    /* the home is kept if the run failed, for the log */
+    std::ifstream result_file(results);
+    if (!result_file.is_open())
+    {
+        std::cerr << "no results, see " << home_dir << "/wayfire.log" << std::endl;
+        return -1;
+    }
+
+    std::cout << result_file.rdbuf();
+    result_file.close();
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    {
+        remove_tree(home_dir);
+    } else
+    {
+        std::cerr << "wayfire didn't exit cleanly, see " << home_dir
+            << "/wayfire.log" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,415 @@
+#include "window.hpp"
+#include "shm-pool.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+
+wayfire_display display;
+
+/* wayfire-loadgen opens a group of surfaces which commit at a set rate,
+ * and reports the latency between a commit and its frame callback.
+ * Several instances can be run to mix different kinds of load */
+struct loadgen_options
+{
+    int surfaces = 10;
+    int width = 640, height = 480;
+    /* commits per second of each surface, 0 to commit only once */
+    double rate = 60;
+    /* the part of the surface which is redrawn on each commit */
+    double damage = 1.0;
+    /* the surfaces grow and shrink by this many pixels, 0 disables it */
+    int resize = 0;
+    /* every burst_interval ms, burst surfaces are closed and reopened */
+    int burst = 0, burst_interval = 1000;
+    /* seconds to run, 0 to run until interrupted */
+    int duration = 0;
+    int report_interval = 5;
+} options;
+
+/* the presets resemble common clients */
+static bool apply_preset(const std::string& name)
+{
+    if (name == "terminal")
+    {
+        /* a few lines of text change at typing speed */
+        options.width = 800; options.height = 600;
+        options.rate = 10; options.damage = 0.05;
+    } else if (name == "video")
+    {
+        options.width = 1280; options.height = 720;
+        options.rate = 60; options.damage = 1.0;
+    } else if (name == "chat")
+    {
+        /* new messages, and windows which come and go */
+        options.width = 600; options.height = 800;
+        options.rate = 2; options.damage = 0.2;
+        options.burst = 1; options.burst_interval = 3000;
+    } else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static double now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+struct load_surface
+{
+    wl_surface *surface;
+    wl_shell_surface *shell_surface;
+
+    /* two buffers of the maximal size, reused after resizing */
+    shm_pool *pool;
+    int offsets[2];
+    wl_buffer *buffers[2] = {nullptr, nullptr};
+    bool busy[2] = {false, false};
+    int current = 0;
+
+    int width, height;
+    int frame_counter = 0;
+
+    double next_commit = 0;
+    wl_callback *frame_callback = nullptr;
+    double frame_requested;
+};
+
+std::vector<load_surface*> surfaces;
+
+struct
+{
+    uint64_t commits = 0, frames = 0, skipped = 0;
+    std::vector<double> latencies;
+} stats;
+
+static void buffer_release(void *data, wl_buffer *buffer)
+{
+    auto ls = (load_surface*) data;
+    for (int i = 0; i < 2; i++)
+    {
+        if (ls->buffers[i] == buffer)
+            ls->busy[i] = false;
+    }
+}
+
+static const wl_buffer_listener buffer_listener = {
+    buffer_release
+};
+
+static void frame_done(void *data, wl_callback *callback, uint32_t time)
+{
+    auto ls = (load_surface*) data;
+
+    stats.latencies.push_back(now_ms() - ls->frame_requested);
+    ++stats.frames;
+
+    wl_callback_destroy(callback);
+    ls->frame_callback = nullptr;
+}
+
+static const wl_callback_listener frame_listener = {
+    frame_done
+};
+
+static void create_buffers(load_surface *ls, int width, int height)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        /* the compositor may still read the old buffers, which
+         * share the memory, but tearing doesn't matter here */
+        if (ls->buffers[i])
+            wl_buffer_destroy(ls->buffers[i]);
+
+        ls->buffers[i] = wl_shm_pool_create_buffer(ls->pool->pool, ls->offsets[i],
+                width, height, width * 4, WL_SHM_FORMAT_ARGB8888);
+        wl_buffer_add_listener(ls->buffers[i], &buffer_listener, ls);
+        ls->busy[i] = false;
+    }
+
+    ls->width = width;
+    ls->height = height;
+}
+
+static void shell_surface_ping(void *data, wl_shell_surface *shell_surface, uint32_t serial)
+{
+    wl_shell_surface_pong(shell_surface, serial);
+}
+
+static void shell_surface_configure(void *data, wl_shell_surface *shell_surface,
+        uint32_t edges, int32_t width, int32_t height) {}
+static void shell_surface_popup_done(void *data, wl_shell_surface *shell_surface) {}
+
+/* the surfaces keep their own size, so configure is ignored */
+static const wl_shell_surface_listener load_shell_surface_listener = {
+    shell_surface_ping, shell_surface_configure, shell_surface_popup_done
+};
+
+static load_surface *create_surface()
+{
+    auto ls = new load_surface;
+
+    int max_w = options.width + options.resize, max_h = options.height + options.resize;
+    size_t buffer_size = max_w * max_h * 4;
+
+    ls->pool = shm_pool_create(display.shm, 2 * buffer_size);
+    if (!ls->pool)
+    {
+        delete ls;
+        return nullptr;
+    }
+
+    for (int i = 0; i < 2; i++)
+        shm_pool_allocate(ls->pool, buffer_size, &ls->offsets[i]);
+
+    ls->surface = wl_compositor_create_surface(display.compositor);
+    ls->shell_surface = wl_shell_get_shell_surface(display.shell, ls->surface);
+    wl_shell_surface_add_listener(ls->shell_surface, &load_shell_surface_listener, NULL);
+    wl_shell_surface_set_toplevel(ls->shell_surface);
+
+    create_buffers(ls, options.width, options.height);
+    return ls;
+}
+
+static void destroy_surface(load_surface *ls)
+{
+    if (ls->frame_callback)
+        wl_callback_destroy(ls->frame_callback);
+
+    for (int i = 0; i < 2; i++)
+        wl_buffer_destroy(ls->buffers[i]);
+
+    wl_shell_surface_destroy(ls->shell_surface);
+    wl_surface_destroy(ls->surface);
+    shm_pool_destroy(ls->pool);
+
+    delete ls;
+}
+
+static void commit_surface(load_surface *ls)
+{
+    if (options.resize)
+    {
+        int delta = options.resize * (0.5 + 0.5 * std::sin(ls->frame_counter / 10.0));
+        if (options.width + delta != ls->width)
+            create_buffers(ls, options.width + delta, options.height + delta);
+    }
+
+    int index = ls->busy[ls->current] ? 1 - ls->current : ls->current;
+    if (ls->busy[index])
+    {
+        /* the compositor holds both buffers, it is behind */
+        ++stats.skipped;
+        return;
+    }
+
+    /* the damaged part moves down the surface, like a scrolling terminal */
+    int damage_h = std::max(1, (int)(ls->height * options.damage));
+    int damage_y = (int64_t)ls->frame_counter * damage_h % (ls->height - damage_h + 1);
+
+    auto pixels = (uint32_t*)((char*)ls->pool->data + ls->offsets[index]);
+    uint32_t color = 0xff000000 | ((uint32_t)ls->frame_counter * 0x010305);
+    std::fill(pixels + damage_y * ls->width,
+            pixels + (damage_y + damage_h) * ls->width, color);
+
+    wl_surface_attach(ls->surface, ls->buffers[index], 0, 0);
+    /* the whole buffer is new after a resize */
+    if (options.resize)
+        wl_surface_damage(ls->surface, 0, 0, ls->width, ls->height);
+    else
+        wl_surface_damage(ls->surface, 0, damage_y, ls->width, damage_h);
+
+    /* only one callback is pending at a time, so the latency isn't
+     * hidden by commits which the compositor skips */
+    if (!ls->frame_callback)
+    {
+        ls->frame_callback = wl_surface_frame(ls->surface);
+        wl_callback_add_listener(ls->frame_callback, &frame_listener, ls);
+        ls->frame_requested = now_ms();
+    }
+
+    wl_surface_commit(ls->surface);
+
+    ls->busy[index] = true;
+    ls->current = 1 - index;
+    ++ls->frame_counter;
+    ++stats.commits;
+}
+
+static void report(double elapsed_ms)
+{
+    auto& lat = stats.latencies;
+    std::sort(lat.begin(), lat.end());
+
+    auto quantile = [&] (double q) {
+        return lat.empty() ? 0.0 : lat[std::min(lat.size() - 1, (size_t)(q * lat.size()))];
+    };
+
+    /* one JSON object per line */
+    std::cout << "{\"elapsed_s\": " << elapsed_ms / 1000
+        << ", \"surfaces\": " << surfaces.size()
+        << ", \"commits\": " << stats.commits
+        << ", \"frames\": " << stats.frames
+        << ", \"skipped\": " << stats.skipped
+        << ", \"frame_latency_ms\": {\"p50\": " << quantile(0.5)
+        << ", \"p90\": " << quantile(0.9)
+        << ", \"p99\": " << quantile(0.99)
+        << ", \"max\": " << (lat.empty() ? 0.0 : lat.back()) << "}}" << std::endl;
+
+    stats.commits = stats.frames = stats.skipped = 0;
+    lat.clear();
+}
+
+static volatile sig_atomic_t running = 1;
+static void handle_sigint(int)
+{
+    running = 0;
+}
+
+static void usage(const char *name)
+{
+    std::cerr << "usage: " << name << " [-p terminal|video|chat] [-n surfaces]"
+        " [-s WxH] [-r commits per second] [-d damaged fraction] [-R resize pixels]"
+        " [-b burst size] [-i burst interval ms] [-t seconds] [-I report interval s]"
+        << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int c;
+    while ((c = getopt(argc, argv, "p:n:s:r:d:R:b:i:t:I:h")) != -1)
+    {
+        switch (c)
+        {
+            case 'p':
+                if (!apply_preset(optarg))
+                {
+                    std::cerr << "unknown preset " << optarg << std::endl;
+                    return -1;
+                }
+                break;
+            case 'n': options.surfaces = std::atoi(optarg); break;
+            case 's': std::sscanf(optarg, "%dx%d", &options.width, &options.height); break;
+            case 'r': options.rate = std::atof(optarg); break;
+            case 'd': options.damage = std::min(1.0, std::max(0.0, std::atof(optarg))); break;
+            case 'R': options.resize = std::atoi(optarg); break;
+            case 'b': options.burst = std::atoi(optarg); break;
+            case 'i': options.burst_interval = std::atoi(optarg); break;
+            case 't': options.duration = std::atoi(optarg); break;
+            case 'I': options.report_interval = std::max(1, std::atoi(optarg)); break;
+            default: usage(argv[0]); return -1;
+        }
+    }
+
+    if (!setup_wayland_connection())
+        return -1;
+
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+
+    double start = now_ms();
+    double period = options.rate > 0 ? 1000 / options.rate : 0;
+    for (int i = 0; i < options.surfaces; i++)
+    {
+        auto ls = create_surface();
+        if (!ls)
+            break;
+
+        /* spread the commits over the period */
+        ls->next_commit = start + period * i / options.surfaces;
+        surfaces.push_back(ls);
+    }
+
+    double next_burst = start + options.burst_interval;
+    double next_report = start + options.report_interval * 1000;
+    double last_report = start;
+
+    while (running)
+    {
+        double now = now_ms();
+        if (options.duration && now - start >= options.duration * 1000)
+            break;
+
+        double next_event = next_report;
+        for (auto ls : surfaces)
+        {
+            if (ls->next_commit < 0)
+                continue;
+
+            if (ls->next_commit <= now)
+            {
+                commit_surface(ls);
+                /* a static surface commits only once, late surfaces don't catch up */
+                ls->next_commit = period > 0 ? std::max(ls->next_commit + period, now) : -1;
+            }
+
+            if (ls->next_commit >= 0)
+                next_event = std::min(next_event, ls->next_commit);
+        }
+
+        if (options.burst > 0)
+        {
+            if (next_burst <= now)
+            {
+                int count = std::min<int>(options.burst, surfaces.size());
+                for (int i = 0; i < count; i++)
+                {
+                    destroy_surface(surfaces.front());
+                    surfaces.erase(surfaces.begin());
+
+                    auto ls = create_surface();
+                    if (ls)
+                        surfaces.push_back(ls);
+                }
+
+                next_burst += options.burst_interval;
+            }
+
+            next_event = std::min(next_event, next_burst);
+        }
+
+        if (next_report <= now)
+        {
+            report(now - last_report);
+            last_report = now;
+            next_report += options.report_interval * 1000;
+        }
+
+        while (wl_display_prepare_read(display.wl_disp) != 0)
+            wl_display_dispatch_pending(display.wl_disp);
+        wl_display_flush(display.wl_disp);
+
+        pollfd fd = {wl_display_get_fd(display.wl_disp), POLLIN, 0};
+        int timeout = std::max(0.0, std::ceil(next_event - now_ms()));
+        if (poll(&fd, 1, timeout) > 0 && (fd.revents & POLLIN))
+        {
+            wl_display_read_events(display.wl_disp);
+        } else
+        {
+            wl_display_cancel_read(display.wl_disp);
+        }
+
+        if (wl_display_dispatch_pending(display.wl_disp) < 0)
+            break;
+    }
+
+    report(now_ms() - last_report);
+
+    for (auto ls : surfaces)
+        destroy_surface(ls);
+    finish_wayland_connection();
+
+    return 0;
+}
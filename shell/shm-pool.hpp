@@ -0,0 +1,24 @@
+#ifndef SHM_POOL_HPP
+#define SHM_POOL_HPP
+
+#include <wayland-client.h>
+#include <sys/types.h>
+
+/* shared memory helpers of the shm-surface backend, also used by
+ * clients which fill their buffers on their own, e.g wayfire-loadgen */
+struct shm_pool
+{
+	wl_shm_pool *pool;
+	size_t size;
+	size_t used;
+	void *data;
+};
+
+int os_create_anonymous_file(off_t size);
+
+/* the pool memory is mapped at data */
+shm_pool *shm_pool_create(wl_shm *shm, size_t size);
+void *shm_pool_allocate(shm_pool *pool, size_t size, int *offset);
+void shm_pool_destroy(shm_pool *pool);
+
+#endif /* end of include guard: SHM_POOL_HPP */
@@ -16,6 +16,7 @@
 
 #include "config.h"
 #include "window.hpp"
+#include "shm-pool.hpp"
 
 struct rectangle
 {
@@ -25,14 +26,6 @@ struct rectangle
 	int height;
 };
 
-struct shm_pool
-{
-	wl_shm_pool *pool;
-	size_t size;
-	size_t used;
-	void *data;
-};
-
 struct shm_surface_data
 {
 	wl_buffer *buffer;
@@ -54,8 +47,6 @@ const cairo_user_data_key_t shm_surface_data_key = {0};
 	return data->buffer;
 }
 
-void shm_pool_destroy(shm_pool *pool);
-
 void shm_surface_data_destroy(void *p)
 {
 	auto data = static_cast<shm_surface_data*> (p);
@@ -182,8 +173,7 @@ shm_pool * shm_pool_create( wl_shm *shm, size_t size)
     return pool;
 }
 
-    static void *
-shm_pool_allocate( shm_pool *pool, size_t size, int *offset)
+void *shm_pool_allocate( shm_pool *pool, size_t size, int *offset)
 {
     if (pool->used + size > pool->size)
         return NULL;
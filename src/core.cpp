@@ -1,6 +1,10 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <csignal>
 
 #include <libweston-desktop.h>
 
@@ -13,6 +17,12 @@
 #endif
 
 #include "signal_definitions.hpp"
+#include "opengl.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "tracing.hpp"
+#include "input-record.hpp"
+#include "gesture-recognizer.hpp"
 #include "../shared/config.hpp"
 #include "../proto/wayfire-shell-server.h"
 
@@ -23,296 +33,28 @@ namespace {
 bool grab_start_finalized;
 };
 
-/* TODO: probably should be made better, this is just basic gesture recognition */
-struct wf_gesture_recognizer {
-
-    constexpr static int MIN_FINGERS = 3;
-    constexpr static int MIN_SWIPE_DISTANCE = 100;
-    constexpr static float MIN_PINCH_DISTANCE = 70;
-
-    struct finger {
-        int id;
-        int sx, sy;
-        int ix, iy;
-        bool sent_to_client, sent_to_grab;
-    };
-
-    std::map<int, finger> current;
-
-    uint32_t last_time;
-    weston_touch *touch;
-
-    bool in_gesture = false, gesture_emitted = false;
-    bool in_grab = false;
-
-    int start_sum_dist;
-
-    std::function<void(wayfire_touch_gesture)> handler;
-
-    wf_gesture_recognizer(weston_touch *_touch,
-            std::function<void(wayfire_touch_gesture)> hnd)
-    {
-        touch = _touch;
-        last_time = 0;
-        handler = hnd;
-    }
-
-    void reset_gesture()
-    {
-        gesture_emitted = false;
-
-        int cx = 0, cy = 0;
-        for (auto f : current) {
-            cx += f.second.sx;
-            cy += f.second.sy;
-        }
-
-        cx /= current.size();
-        cy /= current.size();
-
-        start_sum_dist = 0;
-        for (auto &f : current) {
-            start_sum_dist += std::sqrt((cx - f.second.sx) * (cx - f.second.sx)
-                    + (cy - f.second.sy) * (cy - f.second.sy));
-
-            f.second.ix = f.second.sx;
-            f.second.iy = f.second.sy;
-        }
-    }
-
-    void start_new_gesture(int reason_id)
-    {
-        in_gesture = true;
-        reset_gesture();
-
-        for (auto &f : current) {
-            if (f.first != reason_id) {
-                if (f.second.sent_to_client) {
-                    weston_touch_send_up(touch, last_time, f.first);
-                } else if (f.second.sent_to_grab) {
-                    core->input->grab_send_touch_up(touch, f.first);
-                }
-            }
-
-            f.second.sent_to_grab = f.second.sent_to_client = false;
-        }
-    }
-
-    void stop_gesture()
-    {
-        in_gesture = gesture_emitted = false;
-    }
-
-    void continue_gesture(int id, int sx, int sy)
-    {
-        if (gesture_emitted)
-            return;
-
-        /* first case - consider swipe, we go through each
-         * of the directions and check whether such swipe has occured */
-
-        bool is_left_swipe = true, is_right_swipe = true,
-             is_up_swipe = true, is_down_swipe = true;
-
-        for (auto f : current) {
-            int dx = f.second.sx - f.second.ix;
-            int dy = f.second.sy - f.second.iy;
-
-            if (-MIN_SWIPE_DISTANCE < dx)
-                is_left_swipe = false;
-            if (dx < MIN_SWIPE_DISTANCE)
-                is_right_swipe = false;
-
-            if (-MIN_SWIPE_DISTANCE < dy)
-                is_up_swipe = false;
-            if (dy < MIN_SWIPE_DISTANCE)
-                is_down_swipe = false;
-        }
-
-        uint32_t swipe_dir = 0;
-        if (is_left_swipe)
-            swipe_dir |= GESTURE_DIRECTION_LEFT;
-        if (is_right_swipe)
-            swipe_dir |= GESTURE_DIRECTION_RIGHT;
-        if (is_up_swipe)
-            swipe_dir |= GESTURE_DIRECTION_UP;
-        if (is_down_swipe)
-            swipe_dir |= GESTURE_DIRECTION_DOWN;
-
-        if (swipe_dir) {
-            wayfire_touch_gesture gesture;
-            gesture.type = GESTURE_SWIPE;
-            gesture.finger_count = current.size();
-            gesture.direction = swipe_dir;
-
-
-            handler(gesture);
-            gesture_emitted = true;
-            return;
-        }
-
-        /* second case - this has been a pinch */
-
-        int cx = 0, cy = 0;
-        for (auto f : current) {
-            cx += f.second.sx;
-            cy += f.second.sy;
-        }
-
-        cx /= current.size();
-        cy /= current.size();
-
-        int sum_dist = 0;
-        for (auto f : current) {
-            sum_dist += std::sqrt((cx - f.second.sx) * (cx - f.second.sx)
-                    + (cy - f.second.sy) * (cy - f.second.sy));
-        }
-
-        bool inward_pinch  = (start_sum_dist - sum_dist >= MIN_PINCH_DISTANCE);
-        bool outward_pinch = (start_sum_dist - sum_dist <= -MIN_PINCH_DISTANCE);
-
-        if (inward_pinch || outward_pinch) {
-            wayfire_touch_gesture gesture;
-            gesture.type = GESTURE_PINCH;
-            gesture.finger_count = current.size();
-            gesture.direction =
-                (inward_pinch ? GESTURE_DIRECTION_IN : GESTURE_DIRECTION_OUT);
-
-            handler(gesture);
-            gesture_emitted = true;
-        }
-    }
-
-    void update_touch(int id, int sx, int sy)
-    {
-        current[id].sx = sx;
-        current[id].sy = sy;
-
-        if (in_gesture)
-            continue_gesture(id, sx, sy);
-    }
-
-    void register_touch(int id, int sx, int sy)
-    {
-        auto& f = current[id] = {id, sx, sy, sx, sy, false, false};
-        if (in_gesture)
-            reset_gesture();
-
-        if (current.size() >= MIN_FINGERS && !in_gesture)
-            start_new_gesture(id);
-
-        bool send_to_client = !in_gesture && !in_grab;
-        bool send_to_grab = !in_gesture && in_grab;
-
-        if (send_to_client && id < 1)
-        {
-            core->input->check_touch_bindings(touch,
-                    wl_fixed_from_int(sx), wl_fixed_from_int(sy));
-        }
-
-        /* while checking for touch grabs, some plugin might have started the grab,
-         * so check again */
-        if (in_grab && send_to_client)
-        {
-            send_to_client = false;
-            send_to_grab = true;
-        }
-
-        f.sent_to_grab = send_to_grab;
-        f.sent_to_client = send_to_client;
-
-        assert(!send_to_grab || !send_to_client);
-
-        if (send_to_client)
-        {
-            weston_touch_send_down(touch, last_time, id, wl_fixed_from_int(sx),
-                    wl_fixed_from_int(sy));
-        } else if (send_to_grab)
-        {
-            core->input->grab_send_touch_down(touch, id, wl_fixed_from_int(sx),
-                    wl_fixed_from_int(sy));
-        }
-    }
-
-    void unregister_touch(int id)
-    {
-        /* shouldn't happen, but just in case */
-        if (!current.count(id))
-            return;
-
-        finger f = current[id];
-        current.erase(id);
-        if (in_gesture) {
-            if (current.size() < MIN_FINGERS) {
-                stop_gesture();
-            } else {
-                reset_gesture();
-            }
-        } else if (f.sent_to_client) {
-            weston_touch_send_up(touch, last_time, id);
-        } else if (f.sent_to_grab) {
-            core->input->grab_send_touch_up(touch, id);
-        }
-    }
-
-    bool is_finger_sent_to_client(int id)
-    {
-        auto it = current.find(id);
-        if (it == current.end())
-            return false;
-        return it->second.sent_to_client;
-    }
-
-    bool is_finger_sent_to_grab(int id)
-    {
-        auto it = current.find(id);
-        if (it == current.end())
-            return false;
-        return it->second.sent_to_grab;
-    }
-
-    void start_grab()
-    {
-        in_grab = true;
-
-        for (auto &f : current)
-        {
-            if (f.second.sent_to_client)
-                weston_touch_send_up(touch, last_time, f.first);
-
-            f.second.sent_to_client = false;
-
-            if (!in_gesture)
-            {
-                core->input->grab_send_touch_down(touch, f.first,
-                        wl_fixed_from_int(f.second.sx), wl_fixed_from_int(f.second.sy));
-                f.second.sent_to_grab = true;
-            }
-        }
-    }
-
-    void end_grab()
-    {
-        in_grab = false;
-    }
-};
-
 /* these simply call the corresponding input_manager functions,
  * you can think of them as wrappers for use of libweston */
 void touch_grab_down(weston_touch_grab *grab, uint32_t time, int id,
         wl_fixed_t sx, wl_fixed_t sy)
 {
+    tracing::instant("input_touch_down", id);
+    input_record::record(input_record::TOUCH_DOWN, id, 0, sx, sy);
     core->input->propagate_touch_down(grab->touch, time, id, sx, sy);
 }
 
 void touch_grab_up(weston_touch_grab *grab, uint32_t time, int id)
 {
+    tracing::instant("input_touch_up", id);
+    input_record::record(input_record::TOUCH_UP, id);
     core->input->propagate_touch_up(grab->touch, time, id);
 }
 
 void touch_grab_motion(weston_touch_grab *grab, uint32_t time, int id,
         wl_fixed_t sx, wl_fixed_t sy)
 {
+    tracing::instant("input_touch_motion", id);
+    input_record::record(input_record::TOUCH_MOTION, id, 0, sx, sy);
     core->input->propagate_touch_motion(grab->touch, time, id, sx, sy);
 }
 
@@ -364,20 +106,29 @@ void input_manager::grab_send_touch_down(weston_touch* touch, int32_t id,
         wl_fixed_t sx, wl_fixed_t sy)
 {
     if (active_grab && active_grab->callbacks.touch.down)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.touch.down(touch, id, sx, sy);
+    }
 }
 
 void input_manager::grab_send_touch_up(weston_touch* touch, int32_t id)
 {
     if (active_grab && active_grab->callbacks.touch.up)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.touch.up(touch, id);
+    }
 }
 
 void input_manager::grab_send_touch_motion(weston_touch* touch, int32_t id,
         wl_fixed_t sx, wl_fixed_t sy)
 {
     if (active_grab && active_grab->callbacks.touch.motion)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.touch.motion(touch, id, sx, sy);
+    }
 }
 
 void input_manager::check_touch_bindings(weston_touch* touch, wl_fixed_t sx, wl_fixed_t sy)
@@ -398,6 +149,8 @@ void input_manager::check_touch_bindings(weston_touch* touch, wl_fixed_t sx, wl_
 void pointer_grab_focus(weston_pointer_grab*) { }
 void pointer_grab_axis(weston_pointer_grab *grab, uint32_t time, weston_pointer_axis_event *ev)
 {
+    tracing::instant("input_axis");
+    input_record::record(input_record::AXIS, ev->axis, 0, wl_fixed_from_double(ev->value));
     core->input->propagate_pointer_grab_axis(grab->pointer, ev);
 }
 void pointer_grab_axis_source(weston_pointer_grab*, uint32_t) {}
@@ -405,12 +158,17 @@ void pointer_grab_frame(weston_pointer_grab*) {}
 void pointer_grab_motion(weston_pointer_grab *grab, uint32_t time,
         weston_pointer_motion_event *ev)
 {
+    tracing::instant("input_motion");
     weston_pointer_move(grab->pointer, ev);
+    input_record::record(input_record::MOTION, 0, 0, grab->pointer->x, grab->pointer->y);
     core->input->propagate_pointer_grab_motion(grab->pointer, ev);
 }
 void pointer_grab_button(weston_pointer_grab *grab, uint32_t time,
         uint32_t button, uint32_t state)
 {
+    tracing::instant("input_button", button);
+    input_record::record(input_record::BUTTON, button, state,
+            grab->pointer->x, grab->pointer->y);
     if (grab_start_finalized) {
         weston_compositor_run_button_binding(core->ec, grab->pointer,
                 time, button, (wl_pointer_button_state) state);
@@ -432,6 +190,8 @@ static const weston_pointer_grab_interface pointer_grab_interface = {
 void keyboard_grab_key(weston_keyboard_grab *grab, uint32_t time, uint32_t key,
                        uint32_t state)
 {
+    tracing::instant("input_key", key);
+    input_record::record(input_record::KEY, key, state);
     if (grab_start_finalized) {
         weston_compositor_run_key_binding(core->ec, grab->keyboard, time, key,
                 (wl_keyboard_key_state)state);
@@ -442,6 +202,7 @@ void keyboard_grab_mod(weston_keyboard_grab *grab, uint32_t time,
                        uint32_t depressed, uint32_t locked, uint32_t latched,
                        uint32_t group)
 {
+    input_record::record(input_record::MODIFIERS);
     core->input->propagate_keyboard_grab_mod(grab->keyboard, depressed, locked, latched, group);
 }
 void keyboard_grab_cancel(weston_keyboard_grab *)
@@ -555,14 +316,20 @@ void input_manager::propagate_pointer_grab_axis(weston_pointer *ptr,
         weston_pointer_axis_event *ev)
 {
     if (active_grab->callbacks.pointer.axis)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.pointer.axis(ptr, ev);
+    }
 }
 
 void input_manager::propagate_pointer_grab_motion(
     weston_pointer *ptr, weston_pointer_motion_event *ev)
 {
     if (active_grab->callbacks.pointer.motion)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.pointer.motion(ptr, ev);
+    }
 }
 
 void input_manager::propagate_pointer_grab_button(weston_pointer *ptr,
@@ -570,21 +337,30 @@ void input_manager::propagate_pointer_grab_button(weston_pointer *ptr,
         uint32_t state)
 {
     if (active_grab->callbacks.pointer.button)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.pointer.button(ptr, button, state);
+    }
 }
 
 void input_manager::propagate_keyboard_grab_key(weston_keyboard *kbd,
         uint32_t key, uint32_t state)
 {
     if (active_grab->callbacks.keyboard.key)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.keyboard.key(kbd, key, state);
+    }
 }
 
 void input_manager::propagate_keyboard_grab_mod(weston_keyboard *kbd,
         uint32_t depressed, uint32_t locked, uint32_t latched, uint32_t group)
 {
     if (active_grab->callbacks.keyboard.mod)
+    {
+        profiler::scope scope(active_grab, profiler::HOOK_GRAB);
         active_grab->callbacks.keyboard.mod(kbd, depressed, locked, latched, group);
+    }
 }
 
 void input_manager::end_grabs()
@@ -600,8 +376,23 @@ struct key_callback_data {
 static void keybinding_handler(weston_keyboard *kbd, uint32_t time, uint32_t key, void *data)
 {
     auto ddata = (key_callback_data*) data;
+    tracing::instant("input_key_binding", key);
+
+    /* during grabs, the key was recorded by the grab already */
+    bool was_grabbed = core->input->input_grabbed();
     if (core->get_active_output() == ddata->output)
+    {
+        profiler::scope scope(ddata->call, profiler::HOOK_BINDING);
         (*ddata->call) (kbd, key);
+    }
+
+    /* if the binding started a grab, the release is recorded by it,
+     * otherwise weston swallows the release and it is replayed as a click */
+    if (!was_grabbed)
+    {
+        input_record::record(core->input->input_grabbed() ?
+                input_record::KEY : input_record::KEY_BINDING, key, 1);
+    }
 }
 
 struct button_callback_data {
@@ -613,13 +404,20 @@ static void buttonbinding_handler(weston_pointer *ptr, uint32_t time,
         uint32_t button, void *data)
 {
     auto ddata = (button_callback_data*) data;
+    tracing::instant("input_button_binding", button);
+    if (!core->input->input_grabbed())
+        input_record::record(input_record::BUTTON_BINDING, button, 1, ptr->x, ptr->y);
     if (core->get_active_output() == ddata->output)
+    {
+        profiler::scope scope(ddata->call, profiler::HOOK_BINDING);
         (*ddata->call) (ptr, button);
+    }
 }
 
 weston_binding* input_manager::add_key(uint32_t mod, uint32_t key,
         key_callback *call, wayfire_output *output)
 {
+    profiler::set_hook_owner(call);
     return weston_compositor_add_key_binding(core->ec, key,
             (weston_keyboard_modifier)mod, keybinding_handler, new key_callback_data {call, output});
 }
@@ -627,6 +425,7 @@ weston_binding* input_manager::add_key(uint32_t mod, uint32_t key,
 weston_binding* input_manager::add_button(uint32_t mod,
         uint32_t button, button_callback *call, wayfire_output *output)
 {
+    profiler::set_hook_owner(call);
     return weston_compositor_add_button_binding(core->ec, button,
             (weston_keyboard_modifier)mod, buttonbinding_handler, new button_callback_data {call, output});
 }
@@ -647,6 +446,20 @@ void input_manager::rem_touch(int id)
 }
 /* End input_manager */
 
+/* SIGUSR2 dumps whatever diagnostics are enabled, and flushes the input recording */
+static int handle_sigusr2(int signal, void *data)
+{
+    if (profiler::enabled)
+    {
+        profiler::write_report(wf_debug::logfile);
+        wf_debug::logfile << std::flush;
+    }
+
+    tracing::flush();
+    input_record::flush();
+    return 0;
+}
+
 void wayfire_core::configure(wayfire_config *config)
 {
     this->config = config;
@@ -655,11 +468,67 @@ void wayfire_core::configure(wayfire_config *config)
     vwidth  = section->get_int("vwidth", 3);
     vheight = section->get_int("vheight", 3);
 
-    shadersrc   = section->get_string("shadersrc", INSTALL_PREFIX "/share/wayfire/shaders");
     plugin_path = section->get_string("plugin_path_prefix", INSTALL_PREFIX "/lib/");
     plugins     = section->get_string("plugins", "");
     run_panel   = section->get_int("run_panel", 1);
 
+    render_target_budget_mb = section->get_int("render_target_budget_mb", 256);
+
+    /* milliseconds before the vblank at which repainting starts,
+     * or "adaptive" to measure how long the outputs take to render */
+    auto repaint_msec = section->get_string("repaint_msec", "16");
+    adaptive_repaint_delay = (repaint_msec == "adaptive");
+    if (!adaptive_repaint_delay)
+        ec->repaint_msec = std::max(1, std::atoi(repaint_msec.c_str()));
+    repaint_safety_margin = section->get_int("repaint_safety_margin", 2);
+
+    /* frame timing in the Prometheus text format, disabled if empty */
+    auto metrics_socket = section->get_string("metrics_socket", "");
+    if (!metrics_socket.empty())
+        metrics::start_server(metrics_socket);
+
+    /* account the time spent in hooks to plugins, see profiler.hpp */
+    if (section->get_int("profile", 0))
+        profiler::init();
+
+    /* record a trace of the frames, see tracing.hpp, disabled if empty */
+    auto trace_file = section->get_string("trace_file", "");
+    if (!trace_file.empty())
+        tracing::init(trace_file);
+
+    /* record the input to a file, or replay such a recording, see input-record.hpp */
+    auto input_record_file = section->get_string("input_record", "");
+    if (!input_record_file.empty())
+        input_record::start_recording(input_record_file);
+
+    auto input_replay_file = section->get_string("input_replay", "");
+    if (!input_replay_file.empty())
+        input_record::start_replay(input_replay_file);
+
+    if (profiler::enabled || tracing::enabled || !input_record_file.empty())
+    {
+        auto loop = wl_display_get_event_loop(ec->wl_display);
+        wl_event_loop_add_signal(loop, SIGUSR2, handle_sigusr2, NULL);
+    }
+
+    /* "none" or "frame" - check for GL errors after each frame */
+    OpenGL::frame_error_check =
+        section->get_string("gl_error_check", "none") == "frame";
+
+    /* shaders are built in, this is for development,
+     * for example the root of the source tree */
+    OpenGL::shader_override_dir = section->get_string("shader_override_dir", "");
+
+    /* shadersrc used to be the directory of the installed shaders. The shaders
+     * there are read like the overrides, and the built-in ones are used if missing */
+    auto shadersrc = section->get_string("shadersrc", "");
+    if (!shadersrc.empty())
+    {
+        errio << "core: shadersrc is deprecated, use shader_override_dir" << std::endl;
+        if (OpenGL::shader_override_dir.empty())
+            OpenGL::shader_override_dir = shadersrc;
+    }
+
     section = config->get_section("input");
 
     string model   = section->get_string("xkb_model", "pc100");
@@ -701,7 +570,8 @@ void unbind_desktop_shell(wl_resource *resource)
 
 void bind_desktop_shell(wl_client *client, void *data, uint32_t version, uint32_t id)
 {
-    core->wf_shell.resource = wl_resource_create(client, &wayfire_shell_interface, 1, id);
+    core->wf_shell.resource = wl_resource_create(client, &wayfire_shell_interface,
+            std::min(version, 2u), id);
     core->wf_shell.client = client;
 
     wl_resource_set_implementation(core->wf_shell.resource, &shell_interface_impl,
@@ -721,7 +591,7 @@ void wayfire_core::init(weston_compositor *comp, wayfire_config *conf)
 #endif
 
     if (wl_global_create(ec->wl_display, &wayfire_shell_interface,
-                1, NULL, bind_desktop_shell) == NULL) {
+                2, NULL, bind_desktop_shell) == NULL) {
         errio << "Failed to create wayfire_shell interface" << std::endl;
     }
 }
@@ -751,13 +621,13 @@ void wayfire_core::wake()
     wl_event_loop_add_idle(loop, refocus_idle_cb, 0);
 
     for_each_output([] (wayfire_output *output)
-            { output->signal->emit_signal("wake", nullptr); });
+            { output->signal->emit<wf_signal::wake>(nullptr); });
 }
 
 void wayfire_core::sleep()
 {
     for_each_output([] (wayfire_output *output)
-            { output->signal->emit_signal("sleep", nullptr); });
+            { output->signal->emit<wf_signal::sleep>(nullptr); });
     weston_compositor_sleep(ec);
 }
 
@@ -766,6 +636,10 @@ void wayfire_core::sleep()
  * Maybe we should draw to a surface and display it? */
 void repaint_output_callback(weston_output *o, pixman_region32_t *damage)
 {
+    /* libweston-3 has no hook at the start of its repaint,
+     * this is the first point at which we get control */
+    tracing::span span("repaint_output", o->id);
+
     auto output = core->get_output(o);
     if (output)
         output->render->paint(damage);
@@ -782,6 +656,7 @@ void wayfire_core::hijack_renderer()
 
 void wayfire_core::weston_repaint(weston_output *output, pixman_region32_t *damage)
 {
+    tracing::span span("weston_repaint", output->id);
     weston_renderer_repaint(output, damage);
 }
 
@@ -904,7 +779,7 @@ void wayfire_core::focus_output(wayfire_output *wo)
     if (active_output)
     {
         weston_output_schedule_repaint(active_output->handle);
-        active_output->signal->emit_signal("output-gain-focus", nullptr);
+        active_output->signal->emit<wf_signal::output_gain_focus>(nullptr);
     }
 }
 
@@ -964,10 +839,29 @@ void wayfire_core::for_each_output(output_callback_proc call)
         call(o.second);
 }
 
+void wayfire_core::update_repaint_delay()
+{
+    /* weston uses the same delay for all outputs, so the slowest one decides */
+    float render_time = 0;
+    int64_t refresh_ns = 0;
+    for (auto o : outputs)
+    {
+        render_time = std::max(render_time, o.second->render->get_render_time_p95());
+        refresh_ns = std::max(refresh_ns, o.second->render->get_refresh_ns());
+    }
+
+    /* never start earlier than a whole frame of the output with the lowest refresh rate */
+    int max_repaint_msec = std::max<int64_t>(1, refresh_ns / 1000000);
+    int delay = std::ceil(render_time) + repaint_safety_margin;
+    ec->repaint_msec = std::max(1, std::min(delay, max_repaint_msec));
+}
+
 void wayfire_core::add_view(weston_desktop_surface *ds)
 {
     auto view = std::make_shared<wayfire_view_t> (ds);
     views[view->handle] = view;
+    views_by_desktop_surface[view->desktop_surface] = view;
+    views_by_surface[view->surface] = view;
 
     auto ptr = weston_seat_get_pointer(get_current_seat());
 
@@ -985,34 +879,6 @@ void wayfire_core::add_view(weston_desktop_surface *ds)
     active_output->attach_view(view);
 }
 
-wayfire_view wayfire_core::find_view(weston_view *handle)
-{
-    auto it = views.find(handle);
-    if (it == views.end()) {
-        return nullptr;
-    } else {
-        return it->second;
-    }
-}
-
-wayfire_view wayfire_core::find_view(weston_desktop_surface *desktop_surface)
-{
-    for (auto v : views)
-        if (v.second->desktop_surface == desktop_surface)
-            return v.second;
-
-    return nullptr;
-}
-
-wayfire_view wayfire_core::find_view(weston_surface *surface)
-{
-    for (auto v : views)
-        if (v.second->surface == surface)
-            return v.second;
-
-    return nullptr;
-}
-
 void wayfire_core::focus_view(wayfire_view v, weston_seat *seat)
 {
     if (!v)
@@ -1037,6 +903,8 @@ void wayfire_core::erase_view(wayfire_view v, bool destroy_handle)
     if (!v) return;
 
     views.erase(v->handle);
+    views_by_desktop_surface.erase(v->desktop_surface);
+    views_by_surface.erase(v->surface);
     v->output->detach_view(v);
 
     if (v->handle && destroy_handle)
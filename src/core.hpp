@@ -5,6 +5,7 @@
 #include "plugin.hpp"
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 using output_callback_proc = std::function<void(wayfire_output *)>;
 class input_manager;
@@ -19,7 +20,19 @@ class wayfire_core
 
         wayfire_output *active_output;
         std::map<uint32_t, wayfire_output *> outputs;
-        std::map<weston_view *, wayfire_view> views;
+
+        /* views are looked up on every commit and shell request,
+         * so keep an index for each handle type */
+        std::unordered_map<weston_view *, wayfire_view> views;
+        std::unordered_map<weston_desktop_surface *, wayfire_view> views_by_desktop_surface;
+        std::unordered_map<weston_surface *, wayfire_view> views_by_surface;
+
+        template<class Handle>
+        wayfire_view lookup_view(const std::unordered_map<Handle*, wayfire_view>& index, Handle *handle)
+        {
+            auto it = index.find(handle);
+            return it == index.end() ? nullptr : it->second;
+        }
 
         void configure(wayfire_config *config);
         void (*weston_renderer_repaint) (weston_output *output, pixman_region32_t *damage);
@@ -47,9 +60,12 @@ class wayfire_core
         weston_seat *get_current_seat();
 
         void add_view(weston_desktop_surface *);
-        wayfire_view find_view(weston_view *);
-        wayfire_view find_view(weston_desktop_surface *);
-        wayfire_view find_view(weston_surface *);
+        wayfire_view find_view(weston_view *handle)
+        { return lookup_view(views, handle); }
+        wayfire_view find_view(weston_desktop_surface *desktop_surface)
+        { return lookup_view(views_by_desktop_surface, desktop_surface); }
+        wayfire_view find_view(weston_surface *surface)
+        { return lookup_view(views_by_surface, surface); }
 
         /* completely destroy a view */
         void erase_view(wayfire_view view, bool destroy_libweston_view = false);
@@ -77,9 +93,18 @@ class wayfire_core
 
         int vwidth, vheight;
 
-        std::string shadersrc, plugin_path, plugins;
+        std::string plugin_path, plugins;
         bool run_panel;
 
+        /* how much memory unused offscreen buffers may take, per output */
+        int render_target_budget_mb;
+
+        /* With an adaptive repaint delay, repainting starts as late before
+         * the vblank as the render times of the outputs allow, plus a margin */
+        bool adaptive_repaint_delay;
+        int repaint_safety_margin;
+        void update_repaint_delay();
+
         weston_compositor_backend backend;
 };
 
@@ -0,0 +1,286 @@
+#ifndef GESTURE_RECOGNIZER_HPP
+#define GESTURE_RECOGNIZER_HPP
+
+#include <map>
+#include <cmath>
+#include <cassert>
+#include <functional>
+
+#include "core.hpp"
+#include "input-manager.hpp"
+
+/* TODO: probably should be made better, this is just basic gesture recognition */
+struct wf_gesture_recognizer {
+
+    constexpr static int MIN_FINGERS = 3;
+    constexpr static int MIN_SWIPE_DISTANCE = 100;
+    constexpr static float MIN_PINCH_DISTANCE = 70;
+
+    struct finger {
+        int id;
+        int sx, sy;
+        int ix, iy;
+        bool sent_to_client, sent_to_grab;
+    };
+
+    std::map<int, finger> current;
+
+    uint32_t last_time;
+    weston_touch *touch;
+
+    bool in_gesture = false, gesture_emitted = false;
+    bool in_grab = false;
+
+    int start_sum_dist;
+
+    std::function<void(wayfire_touch_gesture)> handler;
+
+    wf_gesture_recognizer(weston_touch *_touch,
+            std::function<void(wayfire_touch_gesture)> hnd)
+    {
+        touch = _touch;
+        last_time = 0;
+        handler = hnd;
+    }
+
+    void reset_gesture()
+    {
+        gesture_emitted = false;
+
+        int cx = 0, cy = 0;
+        for (auto f : current) {
+            cx += f.second.sx;
+            cy += f.second.sy;
+        }
+
+        cx /= current.size();
+        cy /= current.size();
+
+        start_sum_dist = 0;
+        for (auto &f : current) {
+            start_sum_dist += std::sqrt((cx - f.second.sx) * (cx - f.second.sx)
+                    + (cy - f.second.sy) * (cy - f.second.sy));
+
+            f.second.ix = f.second.sx;
+            f.second.iy = f.second.sy;
+        }
+    }
+
+    void start_new_gesture(int reason_id)
+    {
+        in_gesture = true;
+        reset_gesture();
+
+        for (auto &f : current) {
+            if (f.first != reason_id) {
+                if (f.second.sent_to_client) {
+                    weston_touch_send_up(touch, last_time, f.first);
+                } else if (f.second.sent_to_grab) {
+                    core->input->grab_send_touch_up(touch, f.first);
+                }
+            }
+
+            f.second.sent_to_grab = f.second.sent_to_client = false;
+        }
+    }
+
+    void stop_gesture()
+    {
+        in_gesture = gesture_emitted = false;
+    }
+
+    void continue_gesture(int id, int sx, int sy)
+    {
+        if (gesture_emitted)
+            return;
+
+        /* first case - consider swipe, we go through each
+         * of the directions and check whether such swipe has occured */
+
+        bool is_left_swipe = true, is_right_swipe = true,
+             is_up_swipe = true, is_down_swipe = true;
+
+        for (auto f : current) {
+            int dx = f.second.sx - f.second.ix;
+            int dy = f.second.sy - f.second.iy;
+
+            if (-MIN_SWIPE_DISTANCE < dx)
+                is_left_swipe = false;
+            if (dx < MIN_SWIPE_DISTANCE)
+                is_right_swipe = false;
+
+            if (-MIN_SWIPE_DISTANCE < dy)
+                is_up_swipe = false;
+            if (dy < MIN_SWIPE_DISTANCE)
+                is_down_swipe = false;
+        }
+
+        uint32_t swipe_dir = 0;
+        if (is_left_swipe)
+            swipe_dir |= GESTURE_DIRECTION_LEFT;
+        if (is_right_swipe)
+            swipe_dir |= GESTURE_DIRECTION_RIGHT;
+        if (is_up_swipe)
+            swipe_dir |= GESTURE_DIRECTION_UP;
+        if (is_down_swipe)
+            swipe_dir |= GESTURE_DIRECTION_DOWN;
+
+        if (swipe_dir) {
+            wayfire_touch_gesture gesture;
+            gesture.type = GESTURE_SWIPE;
+            gesture.finger_count = current.size();
+            gesture.direction = swipe_dir;
+
+
+            handler(gesture);
+            gesture_emitted = true;
+            return;
+        }
+
+        /* second case - this has been a pinch */
+
+        int cx = 0, cy = 0;
+        for (auto f : current) {
+            cx += f.second.sx;
+            cy += f.second.sy;
+        }
+
+        cx /= current.size();
+        cy /= current.size();
+
+        int sum_dist = 0;
+        for (auto f : current) {
+            sum_dist += std::sqrt((cx - f.second.sx) * (cx - f.second.sx)
+                    + (cy - f.second.sy) * (cy - f.second.sy));
+        }
+
+        bool inward_pinch  = (start_sum_dist - sum_dist >= MIN_PINCH_DISTANCE);
+        bool outward_pinch = (start_sum_dist - sum_dist <= -MIN_PINCH_DISTANCE);
+
+        if (inward_pinch || outward_pinch) {
+            wayfire_touch_gesture gesture;
+            gesture.type = GESTURE_PINCH;
+            gesture.finger_count = current.size();
+            gesture.direction =
+                (inward_pinch ? GESTURE_DIRECTION_IN : GESTURE_DIRECTION_OUT);
+
+            handler(gesture);
+            gesture_emitted = true;
+        }
+    }
+
+    void update_touch(int id, int sx, int sy)
+    {
+        current[id].sx = sx;
+        current[id].sy = sy;
+
+        if (in_gesture)
+            continue_gesture(id, sx, sy);
+    }
+
+    void register_touch(int id, int sx, int sy)
+    {
+        auto& f = current[id] = {id, sx, sy, sx, sy, false, false};
+        if (in_gesture)
+            reset_gesture();
+
+        if (current.size() >= MIN_FINGERS && !in_gesture)
+            start_new_gesture(id);
+
+        bool send_to_client = !in_gesture && !in_grab;
+        bool send_to_grab = !in_gesture && in_grab;
+
+        if (send_to_client && id < 1)
+        {
+            core->input->check_touch_bindings(touch,
+                    wl_fixed_from_int(sx), wl_fixed_from_int(sy));
+        }
+
+        /* while checking for touch grabs, some plugin might have started the grab,
+         * so check again */
+        if (in_grab && send_to_client)
+        {
+            send_to_client = false;
+            send_to_grab = true;
+        }
+
+        f.sent_to_grab = send_to_grab;
+        f.sent_to_client = send_to_client;
+
+        assert(!send_to_grab || !send_to_client);
+
+        if (send_to_client)
+        {
+            weston_touch_send_down(touch, last_time, id, wl_fixed_from_int(sx),
+                    wl_fixed_from_int(sy));
+        } else if (send_to_grab)
+        {
+            core->input->grab_send_touch_down(touch, id, wl_fixed_from_int(sx),
+                    wl_fixed_from_int(sy));
+        }
+    }
+
+    void unregister_touch(int id)
+    {
+        /* shouldn't happen, but just in case */
+        if (!current.count(id))
+            return;
+
+        finger f = current[id];
+        current.erase(id);
+        if (in_gesture) {
+            if (current.size() < MIN_FINGERS) {
+                stop_gesture();
+            } else {
+                reset_gesture();
+            }
+        } else if (f.sent_to_client) {
+            weston_touch_send_up(touch, last_time, id);
+        } else if (f.sent_to_grab) {
+            core->input->grab_send_touch_up(touch, id);
+        }
+    }
+
+    bool is_finger_sent_to_client(int id)
+    {
+        auto it = current.find(id);
+        if (it == current.end())
+            return false;
+        return it->second.sent_to_client;
+    }
+
+    bool is_finger_sent_to_grab(int id)
+    {
+        auto it = current.find(id);
+        if (it == current.end())
+            return false;
+        return it->second.sent_to_grab;
+    }
+
+    void start_grab()
+    {
+        in_grab = true;
+
+        for (auto &f : current)
+        {
+            if (f.second.sent_to_client)
+                weston_touch_send_up(touch, last_time, f.first);
+
+            f.second.sent_to_client = false;
+
+            if (!in_gesture)
+            {
+                core->input->grab_send_touch_down(touch, f.first,
+                        wl_fixed_from_int(f.second.sx), wl_fixed_from_int(f.second.sy));
+                f.second.sent_to_grab = true;
+            }
+        }
+    }
+
+    void end_grab()
+    {
+        in_grab = false;
+    }
+};
+
+#endif /* end of include guard: GESTURE_RECOGNIZER_HPP */
@@ -0,0 +1,273 @@
+#include "input-record.hpp"
+#include "core.hpp"
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <linux/input.h>
+
+namespace input_record
+{
+    /* the file starts with the magic and the version,
+     * followed by the events in the host's byte order */
+    static const char magic[4] = {'W', 'F', 'I', 'R'};
+    static const uint32_t version = 1;
+
+    struct __attribute__((packed)) event
+    {
+        /* microseconds since the start of the recording */
+        uint64_t time;
+        uint8_t type;
+        uint8_t state;
+        /* the modifier state of the seat, MODIFIER_CTRL etc. */
+        uint16_t mods;
+        /* key, button, axis or touch id */
+        uint32_t code;
+        wl_fixed_t x, y;
+    };
+    static_assert(sizeof(event) == 24, "the trace format depends on the event size");
+
+    static int64_t monotonic_us()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+    }
+
+    static bool recording = false, replaying = false;
+    static std::ofstream record_file;
+    static int64_t record_start;
+    static int unflushed_events = 0;
+
+    void record(event_type type, uint32_t code, uint32_t state, wl_fixed_t x, wl_fixed_t y)
+    {
+        if (!recording || replaying)
+            return;
+
+        auto seat = core->get_current_seat();
+
+        event ev;
+        ev.time = monotonic_us() - record_start;
+        ev.type = type;
+        ev.state = state;
+        ev.mods = seat ? seat->modifier_state : 0;
+        ev.code = code;
+        ev.x = x;
+        ev.y = y;
+
+        record_file.write((const char*)&ev, sizeof(ev));
+
+        /* a crashed session still leaves most of its input behind */
+        if (++unflushed_events >= 64)
+            flush();
+    }
+
+    void flush()
+    {
+        if (!recording)
+            return;
+
+        record_file.flush();
+        unflushed_events = 0;
+    }
+
+    void start_recording(std::string file)
+    {
+        record_file.open(file, std::ios::binary | std::ios::trunc);
+        if (!record_file.is_open())
+        {
+            errio << "input_record: can't open " << file << std::endl;
+            return;
+        }
+
+        record_file.write(magic, sizeof(magic));
+        record_file.write((const char*)&version, sizeof(version));
+
+        record_start = monotonic_us();
+        recording = true;
+
+        info << "input_record: recording to " << file << std::endl;
+    }
+
+    static struct
+    {
+        std::vector<event> events;
+        size_t next = 0;
+        int64_t start;
+        wl_event_source *timer = nullptr;
+        /* buttons pressed by bindings, whose release wasn't seen */
+        std::vector<uint32_t> pressed_buttons;
+    } replay;
+
+    static void send_key(weston_seat *seat, uint32_t key, bool pressed)
+    {
+        notify_key(seat, weston_compositor_get_time(), key,
+                pressed ? WL_KEYBOARD_KEY_STATE_PRESSED : WL_KEYBOARD_KEY_STATE_RELEASED,
+                STATE_UPDATE_AUTOMATIC);
+    }
+
+    static void send_button(weston_seat *seat, uint32_t button, bool pressed)
+    {
+        notify_button(seat, weston_compositor_get_time(), button,
+                pressed ? WL_POINTER_BUTTON_STATE_PRESSED : WL_POINTER_BUTTON_STATE_RELEASED);
+    }
+
+    static void sync_mods(weston_seat *seat, uint32_t mods)
+    {
+        static const std::pair<uint32_t, uint32_t> modifier_keys[] = {
+            {MODIFIER_CTRL, KEY_LEFTCTRL}, {MODIFIER_ALT, KEY_LEFTALT},
+            {MODIFIER_SUPER, KEY_LEFTMETA}, {MODIFIER_SHIFT, KEY_LEFTSHIFT}
+        };
+
+        for (auto& mod : modifier_keys)
+        {
+            bool wanted = mods & mod.first;
+            if (wanted != bool(seat->modifier_state & mod.first))
+                send_key(seat, mod.second, wanted);
+        }
+    }
+
+    static void replay_event(weston_seat *seat, const event& ev)
+    {
+        bool is_touch = ev.type == TOUCH_DOWN || ev.type == TOUCH_UP || ev.type == TOUCH_MOTION;
+        if (is_touch && !weston_seat_get_touch(seat))
+            return;
+
+        sync_mods(seat, ev.mods);
+
+        uint32_t time = weston_compositor_get_time();
+        double x = wl_fixed_to_double(ev.x), y = wl_fixed_to_double(ev.y);
+        auto& pressed = replay.pressed_buttons;
+
+        switch (ev.type)
+        {
+            case KEY:
+                send_key(seat, ev.code, ev.state);
+                break;
+            case KEY_BINDING:
+                send_key(seat, ev.code, true);
+                send_key(seat, ev.code, false);
+                break;
+            case BUTTON_BINDING:
+                /* the release went to a client, so it is missing */
+                if (std::find(pressed.begin(), pressed.end(), ev.code) != pressed.end())
+                    send_button(seat, ev.code, false);
+                else
+                    pressed.push_back(ev.code);
+                /* fallthrough */
+            case BUTTON:
+                notify_motion_absolute(seat, time, x, y);
+                send_button(seat, ev.code, ev.state);
+                if (!ev.state)
+                    pressed.erase(std::remove(pressed.begin(), pressed.end(), ev.code), pressed.end());
+                break;
+            case MOTION:
+                notify_motion_absolute(seat, time, x, y);
+                break;
+            case AXIS:
+            {
+                weston_pointer_axis_event axis;
+                std::memset(&axis, 0, sizeof(axis));
+                axis.axis = ev.code;
+                axis.value = x;
+                notify_axis(seat, time, &axis);
+                break;
+            }
+            case MODIFIERS:
+                break;
+            case TOUCH_DOWN:
+                notify_touch(seat, time, ev.code, x, y, WL_TOUCH_DOWN);
+                break;
+            case TOUCH_UP:
+                notify_touch(seat, time, ev.code, 0, 0, WL_TOUCH_UP);
+                break;
+            case TOUCH_MOTION:
+                notify_touch(seat, time, ev.code, x, y, WL_TOUCH_MOTION);
+                break;
+        }
+    }
+
+    static void finish_replay(weston_seat *seat)
+    {
+        for (auto button : replay.pressed_buttons)
+            send_button(seat, button, false);
+        sync_mods(seat, 0);
+
+        wl_event_source_remove(replay.timer);
+        replay.timer = nullptr;
+        replaying = false;
+
+        info << "input_record: replayed " << replay.events.size() << " events" << std::endl;
+    }
+
+    static int handle_replay_timer(void *data)
+    {
+        auto seat = core->get_current_seat();
+        if (!seat || !weston_seat_get_keyboard(seat) || !weston_seat_get_pointer(seat))
+        {
+            errio << "input_record: no seat to replay the input" << std::endl;
+            wl_event_source_remove(replay.timer);
+            replay.timer = nullptr;
+            replaying = false;
+            return 0;
+        }
+
+        /* the first event is replayed right away, without the idle
+         * time between the start of the recording and it */
+        int64_t now = monotonic_us();
+        if (replay.start < 0)
+            replay.start = now - replay.events.front().time;
+
+        auto& events = replay.events;
+        while (replay.next < events.size() &&
+                (int64_t)events[replay.next].time <= now - replay.start)
+        {
+            replay_event(seat, events[replay.next++]);
+        }
+
+        if (replay.next == events.size())
+        {
+            finish_replay(seat);
+            return 0;
+        }
+
+        int64_t delay_us = events[replay.next].time - (now - replay.start);
+        wl_event_source_timer_update(replay.timer, std::max<int64_t>(1, delay_us / 1000));
+        return 0;
+    }
+
+    void start_replay(std::string file)
+    {
+        std::ifstream in(file, std::ios::binary);
+
+        char file_magic[sizeof(magic)];
+        uint32_t file_version = 0;
+        in.read(file_magic, sizeof(file_magic));
+        in.read((char*)&file_version, sizeof(file_version));
+
+        if (!in || std::memcmp(file_magic, magic, sizeof(magic)) || file_version != version)
+        {
+            errio << "input_record: " << file << " isn't an input trace" << std::endl;
+            return;
+        }
+
+        event ev;
+        while (in.read((char*)&ev, sizeof(ev)))
+            replay.events.push_back(ev);
+
+        if (replay.events.empty())
+            return;
+
+        replay.start = -1;
+
+        /* outputs and plugins are set up once the event loop runs */
+        auto loop = wl_display_get_event_loop(core->ec->wl_display);
+        replay.timer = wl_event_loop_add_timer(loop, handle_replay_timer, NULL);
+        wl_event_source_timer_update(replay.timer, 1000);
+        replaying = true;
+
+        info << "input_record: replaying " << replay.events.size()
+            << " events from " << file << std::endl;
+    }
+}
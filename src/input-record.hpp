@@ -0,0 +1,44 @@
+#ifndef INPUT_RECORD_HPP
+#define INPUT_RECORD_HPP
+
+#include <string>
+#include <cstdint>
+#include <wayland-server.h>
+
+/* Records the input which reaches wayfire(plugin grabs, bindings and the
+ * gesture recognizer) into a compact binary trace, and replays such a trace
+ * through the current seat at the original timing, e.g in the headless
+ * backend. Enabled with [core] input_record or input_replay = <file>.
+ *
+ * Every event carries the modifier state of the seat, which is restored by
+ * pressing and releasing the modifier keys before it is replayed */
+namespace input_record
+{
+    enum event_type : uint8_t
+    {
+        KEY,
+        /* bindings which don't start a grab are seen only on press,
+         * they are replayed as a click */
+        KEY_BINDING,
+        BUTTON,
+        BUTTON_BINDING,
+        MOTION,
+        AXIS,
+        MODIFIERS,
+        TOUCH_DOWN,
+        TOUCH_UP,
+        TOUCH_MOTION
+    };
+
+    /* x, y are global coordinates, for AXIS x is the value */
+    void record(event_type type, uint32_t code = 0, uint32_t state = 0,
+            wl_fixed_t x = 0, wl_fixed_t y = 0);
+
+    void start_recording(std::string file);
+    void flush();
+
+    /* nothing is recorded during the replay */
+    void start_replay(std::string file);
+}
+
+#endif /* end of include guard: INPUT_RECORD_HPP */
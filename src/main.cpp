@@ -2,6 +2,7 @@
 #include <cstring>
 
 #include "output.hpp"
+#include "metrics.hpp"
 #include "debug.hpp"
 #include "weston_backend.hpp"
 #include "desktop_api.hpp"
@@ -62,7 +63,7 @@ int main(int argc, char *argv[]) {
     std::string home_dir = secure_getenv("HOME");
     debug << "Using home directory: " << home_dir << std::endl;
 
-    wayfire_config *config = new wayfire_config(home_dir + "/.config/wayfire.ini", 1000 / ec->repaint_msec);
+    wayfire_config *config = new wayfire_config(home_dir + "/.config/wayfire.ini");
     device_config::load(config);
 
     core = new wayfire_core();
@@ -82,8 +83,14 @@ int main(int argc, char *argv[]) {
 
     wl_signal_add(&ec->seat_created_signal, &seat_created_listener);
 
+    /* the backend is detected from the environment,
+     * unless WAYFIRE_BACKEND=headless is requested */
+    auto backend = getenv("WAYFIRE_BACKEND");
+
     int ret;
-    if (getenv("WAYLAND_DISPLAY") || getenv("WAYLAND_SOCKET")) {
+    if (backend && !std::strcmp(backend, "headless")) {
+        ret = load_headless_backend(ec);
+    } else if (getenv("WAYLAND_DISPLAY") || getenv("WAYLAND_SOCKET")) {
         ret = load_wayland_backend(ec);
     } else if (getenv("DISPLAY")) {
         ret = load_x11_backend(ec);
@@ -133,6 +140,7 @@ int main(int argc, char *argv[]) {
     weston_compositor_wake(ec);
 
     wl_display_run(display);
+    metrics::stop_server();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,233 @@
+#include "metrics.hpp"
+#include "core.hpp"
+#include "output.hpp"
+#include "profiler.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+int wf_histogram::bucket_index(uint64_t value)
+{
+    /* small values have a bucket each */
+    if (value < (uint64_t)sub_buckets)
+        return value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - sub_bucket_bits;
+
+    /* clamp to the last bucket */
+    if (shift + 1 >= magnitudes)
+        return bucket_count - 1;
+
+    int sub = (value >> shift) - sub_buckets;
+    return (shift + 1) * sub_buckets + sub;
+}
+
+uint64_t wf_histogram::bucket_upper_bound(int index)
+{
+    if (index < sub_buckets)
+        return index;
+
+    int shift = index / sub_buckets - 1;
+    uint64_t lower = (uint64_t)(sub_buckets + index % sub_buckets) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void wf_histogram::record(uint64_t value)
+{
+    ++current[bucket_index(value)];
+    ++current_count;
+
+    ++count;
+    sum += value;
+}
+
+void wf_histogram::end_window()
+{
+    std::memcpy(completed, current, sizeof(current));
+    completed_count = current_count;
+
+    std::memset(current, 0, sizeof(current));
+    current_count = 0;
+}
+
+uint64_t wf_histogram::quantile(double q) const
+{
+    if (!completed_count)
+        return 0;
+
+    uint64_t target = std::max<uint64_t>(1, std::ceil(q * completed_count));
+    uint64_t seen = 0;
+    for (int i = 0; i < bucket_count; i++)
+    {
+        seen += completed[i];
+        if (seen >= target)
+            return bucket_upper_bound(i);
+    }
+
+    return bucket_upper_bound(bucket_count - 1);
+}
+
+void wf_frame_metrics::end_window()
+{
+    paint.end_window();
+    renderer.end_window();
+    effects.end_window();
+    swap.end_window();
+    interval.end_window();
+}
+
+namespace metrics
+{
+    static void write_summary(std::ostream& out, const std::string& name,
+            const std::string& help, const std::vector<wayfire_output*>& outputs,
+            wf_histogram wf_frame_metrics::*member)
+    {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " summary\n";
+
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        for (auto output : outputs)
+        {
+            auto& h = output->render->metrics.*member;
+            std::string label = "output=\"" + std::to_string(output->handle->id) + "\"";
+
+            for (auto q : quantiles)
+            {
+                out << name << "{" << label << ",quantile=\"" << q << "\"} "
+                    << h.quantile(q) / 1e6 << "\n";
+            }
+
+            out << name << "_sum{" << label << "} " << h.sum / 1e6 << "\n";
+            out << name << "_count{" << label << "} " << h.count << "\n";
+        }
+    }
+
+    void write_prometheus(std::ostream& out)
+    {
+        std::vector<wayfire_output*> outputs;
+        core->for_each_output([&] (wayfire_output *output) {
+            outputs.push_back(output);
+        });
+
+        write_summary(out, "wayfire_paint_seconds", "Time spent in a whole frame",
+                outputs, &wf_frame_metrics::paint);
+        write_summary(out, "wayfire_renderer_seconds",
+                "Time spent in the output renderer or weston's repaint",
+                outputs, &wf_frame_metrics::renderer);
+        write_summary(out, "wayfire_effects_seconds", "Time spent in effect hooks",
+                outputs, &wf_frame_metrics::effects);
+        write_summary(out, "wayfire_swap_seconds", "Time spent swapping buffers",
+                outputs, &wf_frame_metrics::swap);
+        write_summary(out, "wayfire_frame_interval_seconds",
+                "Time between the starts of consecutive frames",
+                outputs, &wf_frame_metrics::interval);
+
+        out << "# HELP wayfire_missed_deadlines_total Frames finished after "
+            "their predicted presentation\n";
+        out << "# TYPE wayfire_missed_deadlines_total counter\n";
+        for (auto output : outputs)
+        {
+            out << "wayfire_missed_deadlines_total{output=\"" << output->handle->id
+                << "\"} " << output->render->metrics.missed_deadlines << "\n";
+        }
+
+        profiler::write_prometheus(out);
+    }
+
+    static struct
+    {
+        std::string path;
+        int fd = -1;
+        wl_event_source *source = nullptr;
+    } server;
+
+    static int handle_connection(int fd, uint32_t mask, void *data)
+    {
+        int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (client < 0)
+            return 0;
+
+        std::ostringstream out;
+        write_prometheus(out);
+        auto text = out.str();
+
+        /* the snapshot fits in the socket buffer, so we don't wait for
+         * slow clients, they just get a truncated one */
+        if (write(client, text.data(), text.size()) < (ssize_t)text.size())
+            debug << "metrics: snapshot truncated" << std::endl;
+
+        close(client);
+        return 0;
+    }
+
+    void start_server(std::string path)
+    {
+        sockaddr_un addr;
+        if (path.size() >= sizeof(addr.sun_path))
+        {
+            errio << "metrics: socket path too long: " << path << std::endl;
+            return;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+        {
+            errio << "metrics: failed to create socket" << std::endl;
+            return;
+        }
+
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, path.c_str());
+
+        /* remove a socket left over from an earlier run, but nothing else */
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0)
+        {
+            if (!S_ISSOCK(st.st_mode))
+            {
+                errio << "metrics: " << path << " exists and isn't a socket" << std::endl;
+                close(fd);
+                return;
+            }
+
+            unlink(path.c_str());
+        }
+
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0)
+        {
+            errio << "metrics: failed to listen on " << path << std::endl;
+            close(fd);
+            return;
+        }
+
+        auto loop = wl_display_get_event_loop(core->ec->wl_display);
+        server.source = wl_event_loop_add_fd(loop, fd, WL_EVENT_READABLE,
+                handle_connection, NULL);
+        server.fd = fd;
+        server.path = path;
+
+        info << "metrics: listening on " << path << std::endl;
+    }
+
+    void stop_server()
+    {
+        if (server.fd < 0)
+            return;
+
+        wl_event_source_remove(server.source);
+        close(server.fd);
+        unlink(server.path.c_str());
+
+        server.source = nullptr;
+        server.fd = -1;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+/* A histogram of durations(in microseconds) in the style of HdrHistogram:
+ * each power of two is split into sub_buckets linear buckets, so values
+ * are kept with a relative error of at most 1/sub_buckets, and recording
+ * is constant time without allocations.
+ *
+ * Quantiles are computed over the last completed window, see end_window(),
+ * while count and sum are kept over the whole lifetime */
+class wf_histogram
+{
+    public:
+        static const int sub_bucket_bits = 3;
+        static const int sub_buckets = 1 << sub_bucket_bits;
+        /* the largest bucket ends at 2^29us, about 9 minutes */
+        static const int magnitudes = 27;
+        static const int bucket_count = magnitudes * sub_buckets;
+
+        void record(uint64_t value);
+        void end_window();
+
+        /* upper bound of the bucket which contains the quantile q of
+         * the last window, or 0 if it was empty */
+        uint64_t quantile(double q) const;
+
+        uint64_t count = 0, sum = 0;
+
+    private:
+        uint32_t current[bucket_count] = {}, completed[bucket_count] = {};
+        uint64_t current_count = 0, completed_count = 0;
+
+        static int bucket_index(uint64_t value);
+        static uint64_t bucket_upper_bound(int index);
+};
+
+/* timing of the frames of a single output, all durations in microseconds */
+struct wf_frame_metrics
+{
+    /* paint() as a whole, the renderer(or weston's repaint), effect hooks,
+     * buffer swap and the interval between the starts of two frames */
+    wf_histogram paint, renderer, effects, swap, interval;
+
+    /* frames which were not finished by their predicted presentation */
+    uint64_t missed_deadlines = 0;
+
+    void end_window();
+};
+
+namespace metrics
+{
+    /* Write the metrics of all outputs in the Prometheus text format */
+    void write_prometheus(std::ostream& out);
+
+    /* Listen on a Unix socket and send a snapshot to every client
+     * which connects, e.g socat - UNIX-CONNECT:<path> */
+    void start_server(std::string path);
+    /* stop listening and remove the socket */
+    void stop_server();
+}
+
+#endif /* end of include guard: METRICS_HPP */
@@ -1,5 +1,20 @@
 #include "opengl.hpp"
+#include "wayfire-shaders.hpp"
 #include <compositor.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <limits>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if WAYFIRE_DEBUG_ENABLED
+#include <cstring>
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#endif
 
 namespace {
     OpenGL::context_t *bound;
@@ -28,9 +43,30 @@ void gl_call(const char *func, uint32_t line, const char *glfunc) {
 }
 
 namespace OpenGL {
-    GLuint compile_shader(const char *src, GLuint type) {
-        printf("compile shader\n");
+    bool frame_error_check = false;
+
+    void check_frame_errors()
+    {
+        if (!frame_error_check)
+            return;
+
+        /* glGetError() returns one error flag at a time, and some
+         * implementations have several of them */
+        GLenum err, last = GL_NO_ERROR;
+        int count = 0;
+        while ((err = glGetError()) != GL_NO_ERROR && count < 16)
+            last = err, ++count;
+
+        if (count)
+        {
+            errio << "gles: " << count << " error(s) during the last frame, last one is "
+                << gl_error_string(last) << ". Use a debug build to find the call" << std::endl;
+        }
+    }
+}
 
+namespace OpenGL {
+    GLuint compile_shader(const char *src, GLuint type) {
         GLuint shader = GL_CALL(glCreateShader(type));
         GL_CALL(glShaderSource(shader, 1, &src, NULL));
 
@@ -53,57 +89,362 @@ namespace OpenGL {
         return shader;
     }
 
-    GLuint load_shader(const char *path, GLuint type) {
-
+    static bool read_shader_source(const char *path, std::string& str)
+    {
         std::fstream file(path, std::ios::in);
-        if(!file.is_open()) {
-            errio << "Cannot open shader file " << path << ". Aborting\n";
-            std::exit(1);
-        }
-
-        std::string str, line;
+        if (!file.is_open())
+            return false;
 
+        std::string line;
         while(std::getline(file, line))
             str += line, str += '\n';
 
+        return true;
+    }
+
+    GLuint load_shader(const char *path, GLuint type) {
+        std::string str;
+        if (!read_shader_source(path, str)) {
+            errio << "Cannot open shader file " << path << "\n";
+            return -1;
+        }
+
         return compile_shader(str.c_str(), type);
     }
 
-    /*
+    std::string shader_override_dir;
+
+    static std::string get_shader_source(const shader_source_t& shader)
+    {
+        std::string src;
+        if (shader_override_dir.empty())
+            return shader.source;
+
+        std::string path = shader_override_dir + "/" + shader.name;
+        if (!read_shader_source(path.c_str(), src))
+            return shader.source;
+
+        debug << "gles: using shader " << path << std::endl;
+        return src;
+    }
+
+    /* Program cache. Programs are kept by the sources of their shaders,
+     * and linked binaries are stored in $XDG_CACHE_HOME/wayfire, so that
+     * we don't have to compile them on the next start */
+    namespace {
+        struct cached_program
+        {
+            GLuint id;
+            int refcount;
+            /* how long it took to build the program from source */
+            float compile_ms;
+        };
+
+        std::unordered_map<std::string, cached_program> programs;
+        program_cache_stats_t program_stats;
+
+        struct program_binary_header
+        {
+            uint32_t magic;
+            uint32_t format;
+            uint32_t length;
+            float compile_ms;
+        };
+
+        const uint32_t program_binary_magic = 0x42504657; // "WFPB"
+
+        using ms_duration = std::chrono::duration<float, std::milli>;
+    }
+
+    /* FNV-1a, std::hash isn't guaranteed to be the same between builds */
+    static uint64_t hash_string(const std::string& str, uint64_t hash = 14695981039346656037ull)
+    {
+        for (unsigned char c : str)
+            hash = (hash ^ c) * 1099511628211ull;
+        return hash;
+    }
+
+    static std::string get_program_cache_dir()
+    {
+        static bool initialized = false;
+        static std::string dir;
+
+        if (initialized)
+            return dir;
+        initialized = true;
+
+        GLint formats = 0;
+        GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+        if (formats <= 0)
+        {
+            info << "gles: program binaries aren't supported, not caching programs on disk" << std::endl;
+            return dir;
+        }
+
+        const char *xdg_cache = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+
+        std::string base;
+        if (xdg_cache && *xdg_cache)
+            base = xdg_cache;
+        else if (home && *home)
+            base = std::string(home) + "/.cache";
+        else
+            return dir;
+
+        mkdir(base.c_str(), 0700);
+        base += "/wayfire";
+        if (mkdir(base.c_str(), 0700) < 0 && errno != EEXIST)
+            return dir;
+
+        return dir = base;
+    }
+
+    static std::string get_program_binary_path(const std::string& key)
+    {
+        std::string dir = get_program_cache_dir();
+        if (dir.empty())
+            return dir;
+
+        /* binaries work only with the driver which created them */
+        uint64_t hash = hash_string(key);
+        hash = hash_string((const char*) glGetString(GL_RENDERER), hash);
+        hash = hash_string((const char*) glGetString(GL_VERSION), hash);
+
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) hash);
+        return dir + name;
+    }
+
+    static GLuint load_program_binary(const std::string& path, float& compile_ms)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return 0;
+
+        std::streamoff file_size = file.tellg();
+        file.seekg(0);
+
+        /* the file may be truncated or garbage, so check the length
+         * before we allocate anything */
+        program_binary_header header;
+        if (!file.read((char*) &header, sizeof(header)) ||
+                header.magic != program_binary_magic ||
+                header.length == 0 ||
+                header.length > file_size - (std::streamoff) sizeof(header))
+            return 0;
+
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+            return 0;
+
+        GLuint program = GL_CALL(glCreateProgram());
+        GL_CALL(glProgramBinary(program, header.format, binary.data(), binary.size()));
+
+        GLint status = GL_FALSE;
+        GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status == GL_FALSE)
+        {
+            /* probably the driver was updated */
+            debug << "gles: discarding stale program binary " << path << std::endl;
+            GL_CALL(glDeleteProgram(program));
+            unlink(path.c_str());
+            return 0;
+        }
+
+        compile_ms = header.compile_ms;
+        return program;
+    }
+
+    static void save_program_binary(GLuint program, const std::string& path, float compile_ms)
+    {
+        GLint length = 0;
+        GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0)
+            return;
+
+        program_binary_header header;
+        header.magic = program_binary_magic;
+        header.compile_ms = compile_ms;
+
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        GL_CALL(glGetProgramBinary(program, length, &written, &header.format, binary.data()));
+        header.length = written;
+
+        /* write to a temporary file, so that a concurrent reader
+         * never sees a half-written binary */
+        std::string tmp = path + ".tmp";
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return;
+
+        file.write((const char*) &header, sizeof(header));
+        file.write(binary.data(), written);
+        file.close();
+
+        if (!file || rename(tmp.c_str(), path.c_str()) < 0)
+            unlink(tmp.c_str());
+    }
+
+    static GLuint link_program(const std::vector<std::pair<GLenum, std::string>>& sources,
+            bool retrievable)
+    {
+        GLuint program = GL_CALL(glCreateProgram());
+
+        std::vector<GLuint> shaders;
+        for (const auto& src : sources)
+        {
+            GLuint shader = compile_shader(src.second.c_str(), src.first);
+            if (shader == (GLuint)-1)
+                continue;
+
+            GL_CALL(glAttachShader(program, shader));
+            shaders.push_back(shader);
+        }
+
+        if (retrievable) {
+            GL_CALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        }
+
+        GL_CALL(glLinkProgram(program));
+        for (auto shader : shaders)
+        {
+            GL_CALL(glDetachShader(program, shader));
+            GL_CALL(glDeleteShader(shader));
+        }
+
+        GLint status = GL_FALSE;
+        GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status == GL_FALSE)
+        {
+            char log[10000];
+            GL_CALL(glGetProgramInfoLog(program, sizeof(log), NULL, log));
+            errio << "program linking failed!\n" << log << "\n";
+
+            GL_CALL(glDeleteProgram(program));
+            return 0;
+        }
+
+        return program;
+    }
+
+    GLuint create_program(const std::vector<shader_source_t>& shaders)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::pair<GLenum, std::string>> sources;
+        std::string key;
+        for (const auto& shader : shaders)
+        {
+            std::string src = get_shader_source(shader);
+            key += std::to_string(shader.type) + ":" + src;
+            sources.push_back({shader.type, std::move(src)});
+        }
+
+        auto it = programs.find(key);
+        if (it != programs.end())
+        {
+            it->second.refcount++;
+            program_stats.memory_hits++;
+            program_stats.saved_ms += it->second.compile_ms;
+            return it->second.id;
+        }
+
+        std::string binary_path = get_program_binary_path(key);
+
+        float compile_ms = 0;
+        GLuint program = 0;
+        if (!binary_path.empty())
+            program = load_program_binary(binary_path, compile_ms);
+
+        float elapsed;
+        if (program)
+        {
+            elapsed = ms_duration(std::chrono::steady_clock::now() - start).count();
+            program_stats.disk_hits++;
+            program_stats.saved_ms += std::max(0.f, compile_ms - elapsed);
+        } else
+        {
+            program = link_program(sources, !binary_path.empty());
+            if (!program)
+                return 0;
+
+            compile_ms = elapsed =
+                ms_duration(std::chrono::steady_clock::now() - start).count();
+            program_stats.compiles++;
+            program_stats.compile_ms += compile_ms;
+
+            if (!binary_path.empty())
+                save_program_binary(program, binary_path, compile_ms);
+        }
+
+        debug << "gles: program " << program << " ready in " << elapsed
+            << "ms, cache: " << program_stats.memory_hits << " memory hits, "
+            << program_stats.disk_hits << " disk hits, " << program_stats.compiles
+            << " compiled, " << program_stats.saved_ms << "ms saved" << std::endl;
+
+        programs[key] = {program, 1, compile_ms};
+        return program;
+    }
+
+    void release_program(GLuint program)
+    {
+        for (auto it = programs.begin(); it != programs.end(); ++it)
+        {
+            if (it->second.id != program)
+                continue;
+
+            if (--it->second.refcount == 0)
+            {
+                GL_CALL(glDeleteProgram(program));
+                programs.erase(it);
+            }
+
+            return;
+        }
+    }
+
+    const program_cache_stats_t& get_program_cache_stats()
+    {
+        return program_stats;
+    }
+
+#if WAYFIRE_DEBUG_ENABLED
     const char *getStrSrc(GLenum src) {
-        if(src == GL_DEBUG_SOURCE_API            )return "API";
-        if(src == GL_DEBUG_SOURCE_WINDOW_SYSTEM  )return "WINDOW_SYSTEM";
-        if(src == GL_DEBUG_SOURCE_SHADER_COMPILER)return "SHADER_COMPILER";
-        if(src == GL_DEBUG_SOURCE_THIRD_PARTY    )return "THIRD_PARTYB";
-        if(src == GL_DEBUG_SOURCE_APPLICATION    )return "APPLICATIONB";
-        if(src == GL_DEBUG_SOURCE_OTHER          )return "OTHER";
+        if(src == GL_DEBUG_SOURCE_API_KHR            )return "API";
+        if(src == GL_DEBUG_SOURCE_WINDOW_SYSTEM_KHR  )return "WINDOW_SYSTEM";
+        if(src == GL_DEBUG_SOURCE_SHADER_COMPILER_KHR)return "SHADER_COMPILER";
+        if(src == GL_DEBUG_SOURCE_THIRD_PARTY_KHR    )return "THIRD_PARTY";
+        if(src == GL_DEBUG_SOURCE_APPLICATION_KHR    )return "APPLICATION";
+        if(src == GL_DEBUG_SOURCE_OTHER_KHR          )return "OTHER";
         else return "UNKNOWN";
     }
 
     const char *getStrType(GLenum type) {
-        if(type==GL_DEBUG_TYPE_ERROR              )return "ERROR";
-        if(type==GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR)return "DEPRECATED_BEHAVIOR";
-        if(type==GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR )return "UNDEFINED_BEHAVIOR";
-        if(type==GL_DEBUG_TYPE_PORTABILITY        )return "PORTABILITY";
-        if(type==GL_DEBUG_TYPE_PERFORMANCE        )return "PERFORMANCE";
-        if(type==GL_DEBUG_TYPE_OTHER              )return "OTHER";
+        if(type==GL_DEBUG_TYPE_ERROR_KHR              )return "ERROR";
+        if(type==GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR_KHR)return "DEPRECATED_BEHAVIOR";
+        if(type==GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR_KHR )return "UNDEFINED_BEHAVIOR";
+        if(type==GL_DEBUG_TYPE_PORTABILITY_KHR        )return "PORTABILITY";
+        if(type==GL_DEBUG_TYPE_PERFORMANCE_KHR        )return "PERFORMANCE";
+        if(type==GL_DEBUG_TYPE_OTHER_KHR              )return "OTHER";
         return "UNKNOWN";
     }
 
     const char *getStrSeverity(GLenum severity) {
-        if(severity == GL_DEBUG_SEVERITY_HIGH  )return "HIGH";
-        if(severity == GL_DEBUG_SEVERITY_MEDIUM)return "MEDIUM";
-        if(severity == GL_DEBUG_SEVERITY_LOW   )return "LOW";
-        if(severity == GL_DEBUG_SEVERITY_NOTIFICATION) return "NOTIFICATION";
+        if(severity == GL_DEBUG_SEVERITY_HIGH_KHR  )return "HIGH";
+        if(severity == GL_DEBUG_SEVERITY_MEDIUM_KHR)return "MEDIUM";
+        if(severity == GL_DEBUG_SEVERITY_LOW_KHR   )return "LOW";
+        if(severity == GL_DEBUG_SEVERITY_NOTIFICATION_KHR) return "NOTIFICATION";
         return "UNKNOWN";
     }
 
-    void errorHandler(GLenum src, GLenum type,
+    void GL_APIENTRY errorHandler(GLenum src, GLenum type,
             GLuint id, GLenum severity,
             GLsizei len, const GLchar *msg,
             const void *dummy) {
         // ignore notifications
-        if(severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+        if(severity == GL_DEBUG_SEVERITY_NOTIFICATION_KHR)
             return;
         debug << "_______________________________________________\n";
         debug << "GLES debug: \n";
@@ -113,32 +454,125 @@ namespace OpenGL {
         debug << "Severity: " << getStrSeverity(severity) << std::endl;
         debug << "Msg: " << msg << std::endl;;
         debug << "_______________________________________________\n";
-    } */
+    }
+
+    /* the EGL context is shared between outputs, so do this only once */
+    void enable_debug_output()
+    {
+        static bool enabled = false;
+        if (enabled)
+            return;
+        enabled = true;
+
+        auto extensions = (const char*) glGetString(GL_EXTENSIONS);
+        if (!extensions || !std::strstr(extensions, "GL_KHR_debug"))
+        {
+            debug << "gles: GL_KHR_debug not supported" << std::endl;
+            return;
+        }
+
+        auto debug_message_callback = (PFNGLDEBUGMESSAGECALLBACKKHRPROC)
+            eglGetProcAddress("glDebugMessageCallbackKHR");
+        if (!debug_message_callback)
+            return;
+
+        GL_CALL(glEnable(GL_DEBUG_OUTPUT_KHR));
+        GL_CALL(glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR));
+        debug_message_callback(errorHandler, 0);
+    }
+#endif
+
+    /* Quads are streamed into a ring buffer with room for ring_quads quads.
+     * When it is full, the buffer is orphaned and we start from the beginning,
+     * so we never overwrite vertices the GPU might still be using. The index
+     * buffer is static and covers the whole ring, since 16-bit indices are
+     * enough for exactly that many quads */
+    const size_t ring_quads = 65536 / 4;
+    const int floats_per_vertex = 5;
+    const size_t quad_bytes = 4 * floats_per_vertex * sizeof(GLfloat);
+
+    static void create_quad_buffers(context_t *ctx)
+    {
+        GL_CALL(glGenVertexArrays(1, &ctx->quad_vao));
+        GL_CALL(glGenBuffers(1, &ctx->quad_vbo));
+        GL_CALL(glGenBuffers(1, &ctx->quad_ibo));
+        GL_CALL(glBindVertexArray(ctx->quad_vao));
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, ctx->quad_vbo));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, ring_quads * quad_bytes, NULL, GL_STREAM_DRAW));
+        ctx->quad_ring_pos = 0;
+
+        std::vector<GLushort> indices(ring_quads * 6);
+        for (size_t i = 0; i < ring_quads; i++)
+        {
+            /* two triangles for each quad, see write_quad() for the vertex order */
+            GLushort base = i * 4;
+            indices[i * 6 + 0] = base + 0;
+            indices[i * 6 + 1] = base + 1;
+            indices[i * 6 + 2] = base + 2;
+            indices[i * 6 + 3] = base + 0;
+            indices[i * 6 + 4] = base + 2;
+            indices[i * 6 + 5] = base + 3;
+        }
 
-    context_t* create_gles_context(wayfire_output *output, const char *shaderSrcPath) {
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->quad_ibo));
+        GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+                    indices.data(), GL_STATIC_DRAW));
+
+        const GLsizei stride = floats_per_vertex * sizeof(GLfloat);
+        GL_CALL(glVertexAttribPointer(ctx->position, 3, GL_FLOAT, GL_FALSE, stride, (void*)0));
+        GL_CALL(glVertexAttribPointer(ctx->uvPosition, 2, GL_FLOAT, GL_FALSE, stride,
+                    (void*)(3 * sizeof(GLfloat))));
+        GL_CALL(glEnableVertexAttribArray(ctx->position));
+        GL_CALL(glEnableVertexAttribArray(ctx->uvPosition));
+
+        /* libweston and plugins use client-side arrays */
+        GL_CALL(glBindVertexArray(0));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        /* the sampler overrides the parameters of whatever texture we render */
+        GL_CALL(glGenSamplers(1, &ctx->sampler));
+        GL_CALL(glSamplerParameteri(ctx->sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glSamplerParameteri(ctx->sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glSamplerParameteri(ctx->sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glSamplerParameteri(ctx->sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    }
+
+    static void destroy_quad_buffers(context_t *ctx)
+    {
+        glDeleteVertexArrays(1, &ctx->quad_vao);
+        glDeleteBuffers(1, &ctx->quad_vbo);
+        glDeleteBuffers(1, &ctx->quad_ibo);
+        glDeleteSamplers(1, &ctx->sampler);
+    }
+
+    /* NaN never compares equal, so the next value is always uploaded */
+    static void invalidate_uniform_cache(context_t *ctx)
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        ctx->cache.mvp = glm::mat4(nan);
+        ctx->cache.color = glm::vec4(nan);
+        ctx->cache.w2 = ctx->cache.h2 = nan;
+    }
+
+    context_t* create_gles_context(wayfire_output *output) {
         context_t *ctx = new context_t;
         ctx->output = output;
 
-        /*
-        if (file_debug == &file_info) {
-            glEnable(GL_DEBUG_OUTPUT);
-            glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-            glDebugMessageCallback(errorHandler, 0);
-        } */
-
-        GLuint vss = load_shader(std::string(shaderSrcPath)
-                    .append("/vertex.glsl").c_str(),
-                     GL_VERTEX_SHADER);
+#if WAYFIRE_DEBUG_ENABLED
+        enable_debug_output();
+#endif
 
-        GLuint fss = load_shader(std::string(shaderSrcPath)
-                    .append("/frag.glsl").c_str(),
-                     GL_FRAGMENT_SHADER);
+        /* the program is shared between all outputs */
+        ctx->program = create_program({
+                EMBEDDED_SHADER(GL_VERTEX_SHADER, core_shaders::vertex_glsl),
+                EMBEDDED_SHADER(GL_FRAGMENT_SHADER, core_shaders::frag_glsl)});
 
-        ctx->program = GL_CALL(glCreateProgram());
+        if (!ctx->program) {
+            errio << "Failed to create the default program. Aborting\n";
+            std::exit(1);
+        }
 
-        GL_CALL(glAttachShader(ctx->program, vss));
-        GL_CALL(glAttachShader(ctx->program, fss));
-        GL_CALL(glLinkProgram(ctx->program));
         GL_CALL(glUseProgram(ctx->program));
 
         ctx->mvpID   = GL_CALL(glGetUniformLocation(ctx->program, "MVP"));
@@ -152,6 +586,16 @@ namespace OpenGL {
 
         ctx->position   = GL_CALL(glGetAttribLocation(ctx->program, "position"));
         ctx->uvPosition = GL_CALL(glGetAttribLocation(ctx->program, "uvPosition"));
+
+        /* we just changed the uniforms of the shared program */
+        invalidate_uniform_cache(ctx);
+        if (bound)
+            invalidate_uniform_cache(bound);
+        ctx->cache.viewport_valid = false;
+
+        create_quad_buffers(ctx);
+
+        ctx->stats.draw_calls = ctx->stats.quads = 0;
         return ctx;
     }
 
@@ -160,6 +604,11 @@ namespace OpenGL {
     }
 
     void bind_context(context_t *ctx) {
+        /* the default program is shared, so the
+         * previous context might have changed its uniforms */
+        if (bound != ctx)
+            invalidate_uniform_cache(ctx);
+
         bound = ctx;
 
         int w = ctx->output->handle->width;
@@ -184,31 +633,63 @@ namespace OpenGL {
         bound->device_width = real_w;
         bound->device_height = real_h;
 
+        /* somebody else might have changed the viewport meanwhile */
+        bound->cache.viewport_valid = false;
     }
 
     void release_context(context_t *ctx) {
-        glDeleteProgram(ctx->program);
+        release_program(ctx->program);
+        destroy_quad_buffers(ctx);
+
+        if (bound == ctx)
+            bound = nullptr;
         delete ctx;
     }
 
-    void render_texture(GLuint tex, const weston_geometry& g,
-            const texture_geometry& texg, uint32_t bits)
+    void set_viewport(int x, int y, int w, int h)
     {
-        if ((bits & DONT_RELOAD_PROGRAM) == 0) {
-            GL_CALL(glUseProgram(bound->program));
+        auto& vp = bound->cache.viewport;
+        if (bound->cache.viewport_valid &&
+                vp[0] == x && vp[1] == y && vp[2] == w && vp[3] == h)
+            return;
+
+        GL_CALL(glViewport(x, y, w, h));
+        vp[0] = x; vp[1] = y; vp[2] = w; vp[3] = h;
+        bound->cache.viewport_valid = true;
+    }
+
+    /* uniforms are state of our program, so nobody else changes them
+     * and we can skip uploading the same values again */
+    static void set_uniform(GLuint id, float& cached, float value)
+    {
+        if (cached == value)
+            return;
+
+        GL_CALL(glUniform1f(id, value));
+        cached = value;
+    }
+
+    static void set_transform_uniforms(const glm::mat4& model, const glm::vec4& color)
+    {
+        if (bound->cache.mvp != model)
+        {
+            GL_CALL(glUniformMatrix4fv(bound->mvpID, 1, GL_FALSE, &model[0][0]));
+            bound->cache.mvp = model;
         }
-        GL_CALL(glUniform1f(bound->w2ID, bound->width / 2));
-        GL_CALL(glUniform1f(bound->h2ID, bound->height / 2));
 
-        if ((bits & TEXTURE_TRANSFORM_USE_DEVCOORD)) {
-            GL_CALL(glViewport(0, 0, bound->device_width, bound->device_height));
-        } else {
-            GL_CALL(glViewport(0, 0, bound->width, bound->height));
+        if (bound->cache.color != color)
+        {
+            GL_CALL(glUniform4fv(bound->colorID, 1, &color[0]));
+            bound->cache.color = color;
         }
+    }
 
+    static void write_quad(GLfloat *v, const texture_quad& quad, uint32_t bits)
+    {
         float w2 = float(bound->width) / 2.;
         float h2 = float(bound->height) / 2.;
 
+        const auto& g = quad.geometry;
         float tlx = float(g.x) - w2,
               tly = h2 - float(g.y);
 
@@ -220,65 +701,133 @@ namespace OpenGL {
             tly += h;
         }
 
-        GLfloat vertexData[] = {
-            tlx    , tly - h, 0.f, // 1
-            tlx + w, tly - h, 0.f, // 2
-            tlx + w, tly    , 0.f, // 3
-            tlx    , tly    , 0.f, // 4
-        };
-
+        texture_geometry texg = {0.0f, 0.0f, 1.0f, 1.0f};
+        if (bits & TEXTURE_USE_TEX_GEOMETRY)
+            texg = quad.texg;
 
-        GLfloat coordData[] = {
-            0.0f, 1.0f,
-            1.0f, 1.0f,
-            1.0f, 0.0f,
-            0.0f, 0.0f,
+        const GLfloat data[] = {
+            tlx    , tly - h, 0.f, texg.x1, texg.y2, // 1
+            tlx + w, tly - h, 0.f, texg.x2, texg.y2, // 2
+            tlx + w, tly    , 0.f, texg.x2, texg.y1, // 3
+            tlx    , tly    , 0.f, texg.x1, texg.y1, // 4
         };
 
-        if (bits & TEXTURE_USE_TEX_GEOMETRY) {
-            coordData[0] = texg.x1; coordData[1] = texg.y2;
-            coordData[2] = texg.x2; coordData[3] = texg.y2;
-            coordData[4] = texg.x2; coordData[5] = texg.y1;
-            coordData[6] = texg.x1; coordData[7] = texg.y1;
+        std::copy(data, data + 4 * floats_per_vertex, v);
+    }
+
+    /* @param own_program - whether our program is in use,
+     * if not, then the uniform cache can't be used */
+    static void draw_quads(GLuint tex, const texture_quad *quads, size_t count,
+            uint32_t bits, bool own_program)
+    {
+        if (own_program)
+        {
+            set_uniform(bound->w2ID, bound->cache.w2, bound->width / 2);
+            set_uniform(bound->h2ID, bound->cache.h2, bound->height / 2);
+        } else
+        {
+            GL_CALL(glUniform1f(bound->w2ID, bound->width / 2));
+            GL_CALL(glUniform1f(bound->h2ID, bound->height / 2));
         }
 
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        if ((bits & TEXTURE_TRANSFORM_USE_DEVCOORD)) {
+            set_viewport(0, 0, bound->device_width, bound->device_height);
+        } else {
+            set_viewport(0, 0, bound->width, bound->height);
+        }
 
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
         GL_CALL(glActiveTexture(GL_TEXTURE0));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+        GL_CALL(glBindSampler(0, bound->sampler));
+
+        GL_CALL(glBindVertexArray(bound->quad_vao));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bound->quad_vbo));
+
+        size_t done = 0;
+        while (done < count)
+        {
+            size_t chunk = std::min(count - done, ring_quads);
+            if (bound->quad_ring_pos + chunk > ring_quads)
+            {
+                GL_CALL(glBufferData(GL_ARRAY_BUFFER, ring_quads * quad_bytes,
+                            NULL, GL_STREAM_DRAW));
+                bound->quad_ring_pos = 0;
+            }
+
+            auto v = (GLfloat*) GL_CALL(glMapBufferRange(GL_ARRAY_BUFFER,
+                        bound->quad_ring_pos * quad_bytes, chunk * quad_bytes,
+                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                        GL_MAP_UNSYNCHRONIZED_BIT));
+            if (!v)
+            {
+                errio << "Failed to map the quad buffer" << std::endl;
+                break;
+            }
+
+            for (size_t i = 0; i < chunk; i++)
+                write_quad(v + i * 4 * floats_per_vertex, quads[done + i], bits);
+            GL_CALL(glUnmapBuffer(GL_ARRAY_BUFFER));
 
-        GL_CALL(glVertexAttribPointer(bound->position, 3, GL_FLOAT, GL_FALSE, 0, vertexData));
-        GL_CALL(glEnableVertexAttribArray(bound->position));
+            /* the index of the first vertex of a quad in the ring
+             * is the same as the index of its first index */
+            GL_CALL(glDrawElements(GL_TRIANGLES, chunk * 6, GL_UNSIGNED_SHORT,
+                        (void*)(bound->quad_ring_pos * 6 * sizeof(GLushort))));
 
-        GL_CALL(glVertexAttribPointer(bound->uvPosition, 2, GL_FLOAT, GL_FALSE, 0, coordData));
-        GL_CALL(glEnableVertexAttribArray(bound->uvPosition));
+            bound->quad_ring_pos += chunk;
+            bound->stats.draw_calls++;
+            bound->stats.quads += chunk;
+            done += chunk;
+        }
+
+        GL_CALL(glBindVertexArray(0));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        GL_CALL(glBindSampler(0, 0));
+    }
 
-        GL_CALL(glDrawArrays (GL_TRIANGLE_FAN, 0, 4));
+    void render_texture(GLuint tex, const weston_geometry& g,
+            const texture_geometry& texg, uint32_t bits)
+    {
+        bool own_program = (bits & DONT_RELOAD_PROGRAM) == 0;
+        if (own_program) {
+            GL_CALL(glUseProgram(bound->program));
+        }
 
-        GL_CALL(glDisableVertexAttribArray(bound->position));
-        GL_CALL(glDisableVertexAttribArray(bound->uvPosition));
+        texture_quad quad = {g, texg};
+        draw_quads(tex, &quad, 1, bits, own_program);
     }
 
     void render_transformed_texture(GLuint tex, const weston_geometry& g,
             const texture_geometry& texg, glm::mat4 model,
             glm::vec4 color, uint32_t bits)
     {
-        GL_CALL(glUseProgram(bound->program));
+        texture_quad quad = {g, texg};
+        render_transformed_texture_quads(tex, &quad, 1, model, color, bits);
+    }
+
+    void render_transformed_texture_quads(GLuint tex, const texture_quad *quads,
+            size_t count, glm::mat4 model, glm::vec4 color, uint32_t bits)
+    {
+        if (!count)
+            return;
 
-        GL_CALL(glUniformMatrix4fv(bound->mvpID, 1, GL_FALSE, &model[0][0]));
-        GL_CALL(glUniform4fv(bound->colorID, 1, &color[0]));
+        GL_CALL(glUseProgram(bound->program));
+        set_transform_uniforms(model, color);
 
         GL_CALL(glEnable(GL_BLEND));
         GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-        render_texture(tex, g, texg, bits | DONT_RELOAD_PROGRAM);
+        draw_quads(tex, quads, count, bits, true);
         GL_CALL(glDisable(GL_BLEND));
     }
 
     void prepare_framebuffer(GLuint &fbuff, GLuint &texture,
                              float scale_x, float scale_y)
+    {
+        prepare_framebuffer_size(fbuff, texture,
+                bound->width * scale_x, bound->height * scale_y);
+    }
+
+    void prepare_framebuffer_size(GLuint &fbuff, GLuint &texture,
+                                  int width, int height, GLenum format)
     {
         if (fbuff == (uint)-1)
             GL_CALL(glGenFramebuffers(1, &fbuff));
@@ -296,10 +845,13 @@ namespace OpenGL {
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 
-        if (!existing_texture)
-            GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                        bound->width * scale_x, bound->height * scale_y,
+        if (!existing_texture && format == GL_RGB565) {
+            GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB565, width, height,
+                        0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0));
+        } else if (!existing_texture) {
+            GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
                         0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+        }
 
         GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                 texture, 0));
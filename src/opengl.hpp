@@ -9,6 +9,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <map>
+#include <vector>
+#include <string>
+#include "config.h"
 #include "output.hpp"
 
 void gl_call(const char*, uint32_t, const char*);
@@ -19,7 +22,13 @@ void gl_call(const char*, uint32_t, const char*);
 
 /* recommended to use this to make OpenGL calls, since it offers easier debugging */
 /* This macro is taken from WLC source code */
+/* glGetError() can stall the pipeline, so in release builds errors are
+ * checked only once per frame, if enabled (see OpenGL::check_frame_errors()) */
+#if WAYFIRE_DEBUG_ENABLED
 #define GL_CALL(x) x; gl_call(__PRETTY_FUNCTION__, __LINE__, __STRING(x))
+#else
+#define GL_CALL(x) x
+#endif
 
 #define TEXTURE_TRANSFORM_INVERT_X     (1 << 0)
 #define TEXTURE_TRANSFORM_INVERT_Y     (1 << 1)
@@ -35,6 +44,12 @@ namespace OpenGL {
         float x1, y1, x2, y2;
     };
 
+    /* a part of a texture, rendered at the given geometry */
+    struct texture_quad {
+        weston_geometry geometry;
+        texture_geometry texg;
+    };
+
     /* Different Context is kept for each output */
     /* Each of the following functions uses the currently bound context */
     struct context_t {
@@ -48,10 +63,41 @@ namespace OpenGL {
         wayfire_output *output;
         int32_t width, height;
         int32_t device_width, device_height;
+
+        /* quads are rendered from a ring buffer, see opengl.cpp */
+        GLuint quad_vao, quad_vbo, quad_ibo;
+        size_t quad_ring_pos;
+        GLuint sampler;
+
+        /* Values we have last set, so that we can skip redundant GL calls.
+         * The default program is shared between contexts, so bind_context()
+         * resets the uniforms when switching contexts, and the viewport always */
+        struct {
+            glm::mat4 mvp;
+            glm::vec4 color;
+            float w2, h2;
+
+            bool viewport_valid;
+            GLint viewport[4];
+        } cache;
+
+        /* counted since the last reset by the render manager */
+        struct {
+            uint64_t draw_calls;
+            uint64_t quads;
+        } stats;
     };
 
-    context_t* create_gles_context(wayfire_output *output, const char *shader_src_path);
+    context_t* create_gles_context(wayfire_output *output);
     void bind_context(context_t* ctx);
+
+    /* set from the gl_error_check option in the core section */
+    extern bool frame_error_check;
+    /* report GL errors which happened since the last call, if frame_error_check */
+    void check_frame_errors();
+
+    /* use this instead of glViewport(), so that the viewport can be cached */
+    void set_viewport(int x, int y, int w, int h);
     void release_context(context_t *ctx);
 
     /* texg arguments are used only when bits has USE_TEX_GEOMETRY
@@ -62,13 +108,56 @@ namespace OpenGL {
     void render_texture(GLuint tex, const weston_geometry& g,
             const texture_geometry& texg, uint32_t bits);
 
+    /* same as render_transformed_texture(), but renders many parts of the
+     * texture with a single draw call. texg is used only with TEXTURE_USE_TEX_GEOMETRY */
+    void render_transformed_texture_quads(GLuint tex, const texture_quad *quads,
+            size_t count, glm::mat4 transform = glm::mat4(),
+            glm::vec4 color = glm::vec4(1.f), uint32_t bits = 0);
+
     GLuint duplicate_texture(GLuint source_tex, int w, int h);
 
     GLuint load_shader(const char *path, GLuint type);
     GLuint compile_shader(const char *src, GLuint type);
 
+    /* Shaders are embedded at build time with wayfire_embed_shaders(),
+     * see cmake/EmbedShaders.cmake. If shader_override_dir is set, a file
+     * with the same name there is used instead(useful for development) */
+    struct shader_source_t
+    {
+        GLenum type;
+        /* path relative to the source tree */
+        const char *name;
+        const char *source;
+    };
+
+    /* set from the shader_override_dir option in the core section */
+    extern std::string shader_override_dir;
+
+/* for example EMBEDDED_SHADER(GL_VERTEX_SHADER, core_shaders::vertex_glsl) */
+#define EMBEDDED_SHADER(type, var) OpenGL::shader_source_t{type, var##_name, var}
+
+    /* Create a program from the given shaders.
+     * Programs are shared between everybody who uses the same shaders, so
+     * uniforms should be set every time the program is used.
+     * Returns 0 on failure. */
+    GLuint create_program(const std::vector<shader_source_t>& shaders);
+    /* release a program created with create_program() */
+    void release_program(GLuint program);
+
+    struct program_cache_stats_t
+    {
+        int memory_hits, disk_hits, compiles;
+        /* total time spent compiling, and the estimated time saved by the cache */
+        float compile_ms, saved_ms;
+    };
+    const program_cache_stats_t& get_program_cache_stats();
+
     void prepare_framebuffer(GLuint& fbuff, GLuint& texture,
             float scale_x = 1, float scale_y = 1);
+    /* same as prepare_framebuffer(), but the texture has the given size.
+     * format is GL_RGBA or GL_RGB565 */
+    void prepare_framebuffer_size(GLuint& fbuff, GLuint& texture,
+            int width, int height, GLenum format = GL_RGBA);
 
     /* set program to current program */
     void use_default_program();
@@ -1,4 +1,6 @@
 #include "opengl.hpp"
+#include "profiler.hpp"
+#include "tracing.hpp"
 #include "output.hpp"
 #include "signal_definitions.hpp"
 #include "input-manager.hpp"
@@ -11,6 +13,8 @@
 #include <memory>
 #include <dlfcn.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
@@ -48,7 +52,13 @@ struct plugin_manager
             p->grab_interface = new wayfire_grab_interface_t(o);
             p->output = o;
 
-            p->init(config);
+            auto owner = profiler::create_owner();
+            {
+                profiler::scope scope(owner, profiler::HOOK_INIT);
+                profiler::set_hook_owner(p->grab_interface);
+                p->init(config);
+            }
+            profiler::set_owner_name(owner, p->grab_interface->name);
         }
     }
 
@@ -153,16 +163,63 @@ render_manager::render_manager(wayfire_output *o)
 
     pixman_region32_init(&frame_damage);
     pixman_region32_init(&prev_damage);
+    pixman_region32_init(&frame_scratch.ws_damage);
+    pixman_region32_init(&frame_scratch.visible);
+    pixman_region32_init(&frame_scratch.surface_damage);
+
+    pixman_region32_init(&pending_damage);
+    pixman_region32_init(&repaint_region);
+    for (int i = 0; i < damage_history_size; i++)
+        pixman_region32_init(&damage_history[i]);
+
+    render_target_budget = (size_t)core->render_target_budget_mb << 20;
+}
+
+render_manager::~render_manager()
+{
+    pixman_region32_fini(&frame_damage);
+    pixman_region32_fini(&prev_damage);
+    pixman_region32_fini(&frame_scratch.ws_damage);
+    pixman_region32_fini(&frame_scratch.visible);
+    pixman_region32_fini(&frame_scratch.surface_damage);
+
+    if (frame_animation_active)
+        wl_list_remove(&frame_animation.link);
+
+    pixman_region32_fini(&pending_damage);
+    pixman_region32_fini(&repaint_region);
+    for (int i = 0; i < damage_history_size; i++)
+        pixman_region32_fini(&damage_history[i]);
+
+    for (auto& dv : frame_scratch.damaged_views)
+        pixman_region32_fini(&dv.damage);
+
+    for (auto& entry : render_target_pool)
+    {
+        GL_CALL(glDeleteFramebuffers(1, &entry.target.fbuff));
+        GL_CALL(glDeleteTextures(1, &entry.target.tex));
+    }
+}
+
+void render_manager::reset_frame_scratch()
+{
+    frame_scratch.effects.clear();
+    frame_scratch.views.clear();
+    /* the streams reset only the count, so the views may still be referenced */
+    for (auto& dv : frame_scratch.damaged_views)
+        dv.view = nullptr;
+
+    frame_scratch.damaged_views_count = 0;
 }
 
 void render_manager::load_context()
 {
-    ctx = OpenGL::create_gles_context(output, core->shadersrc.c_str());
+    ctx = OpenGL::create_gles_context(output);
     OpenGL::bind_context(ctx);
 
     dirty_context = false;
 
-    output->signal->emit_signal("reload-gl", nullptr);
+    output->signal->emit<wf_signal::reload_gl>(nullptr);
 }
 
 void render_manager::release_context()
@@ -171,11 +228,45 @@ void render_manager::release_context()
     dirty_context = true;
 }
 
-void redraw_idle_cb(void *data)
+std::function<void(timespec*)> render_manager::frame_clock = [] (timespec *ts)
+{
+    weston_compositor_read_presentation_clock(core->ec, ts);
+};
+
+bool render_manager::wants_next_frame()
+{
+    return constant_redraw > 0 || !frame_hooks.empty();
+}
+
+/* weston clears the repaint request at the end of paint(), and runs the
+ * animations of the output after that, so the request is repeated there */
+template<class T>
+void render_manager::frame_animation_cb(weston_animation *animation, weston_output*, T)
 {
-    wayfire_output *output = (wayfire_output*) data;
-    assert(output);
+    render_manager *render = wl_container_of(animation, render, frame_animation);
+
+    /* the last animation might have stopped in the meantime */
+    if (render->wants_next_frame())
+    {
+        weston_output_schedule_repaint(render->output->handle);
+    } else
+    {
+        wl_list_remove(&animation->link);
+        render->frame_animation_active = false;
+    }
+}
+
+void render_manager::schedule_next_frame()
+{
+    if (frame_animation_active)
+        return;
 
+    frame_animation.frame = frame_animation_cb;
+    frame_animation.frame_counter = 0;
+    wl_list_insert(&output->handle->animation_list, &frame_animation.link);
+    frame_animation_active = true;
+
+    /* the output may be idle, then nothing would run the animation */
     weston_output_schedule_repaint(output->handle);
 }
 
@@ -190,20 +281,142 @@ void render_manager::auto_redraw(bool redraw)
         return;
     }
 
-    auto loop = wl_display_get_event_loop(core->ec->wl_display);
-    wl_event_loop_add_idle(loop, redraw_idle_cb, output);
+    if (constant_redraw)
+        schedule_next_frame();
+}
+
+void render_manager::add_frame_hook(frame_hook_t *hook)
+{
+    frame_hooks.push_back(hook);
+    profiler::set_hook_owner(hook);
+    schedule_next_frame();
+}
+
+void render_manager::rem_frame_hook(const frame_hook_t *hook)
+{
+    auto it = std::remove(frame_hooks.begin(), frame_hooks.end(), hook);
+    frame_hooks.erase(it, frame_hooks.end());
+    profiler::forget_hook(hook);
+}
+
+static int64_t timespec_to_ns(const timespec& ts)
+{
+    return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int64_t frame_clock_now()
+{
+    timespec now;
+    render_manager::frame_clock(&now);
+    return timespec_to_ns(now);
+}
+
+/* weston_output::frame_time, the timestamp of the last presentation. Older
+ * libweston versions keep only the lower 32 bits of its milliseconds */
+static int64_t presentation_ns(uint32_t frame_time_ms, int64_t now_ns)
+{
+    uint32_t age_ms = uint32_t(now_ns / 1000000) - frame_time_ms;
+    return (now_ns / 1000000 - age_ms) * 1000000;
+}
+
+static int64_t presentation_ns(const timespec& frame_time, int64_t)
+{
+    return timespec_to_ns(frame_time);
+}
+
+int64_t render_manager::get_refresh_ns()
+{
+    auto mode = output->handle->current_mode;
+    if (mode && mode->refresh > 0)
+        return 1000000000000ll / mode->refresh;
+
+    return 1000000000ll / 60;
+}
+
+/* set while an output is painted, -1 otherwise */
+static int64_t painted_frame_time = -1;
+
+int64_t wf_get_frame_time()
+{
+    if (painted_frame_time >= 0)
+        return painted_frame_time;
+
+    return frame_clock_now();
+}
+
+/* Vblanks happen every refresh period after the last presentation reported
+ * by weston, and weston starts the repaint repaint_msec before one of them.
+ * The frame is shown at the first vblank after the start of the repaint,
+ * unless it isn't ready by then, which is a missed deadline */
+void render_manager::run_frame_hooks()
+{
+    int64_t now = frame_clock_now();
+    if (frame_start_ns > 0)
+        metrics.interval.record((now - frame_start_ns) / 1000);
+    frame_start_ns = now;
+
+    timespec weston_now;
+    weston_compositor_read_presentation_clock(core->ec, &weston_now);
+    int64_t weston_now_ns = timespec_to_ns(weston_now);
+    int64_t presented = presentation_ns(output->handle->frame_time, weston_now_ns);
+    int64_t since_presentation = std::max<int64_t>(0, weston_now_ns - presented);
+
+    int64_t refresh_ns = get_refresh_ns();
+    predicted_presentation_ns = now - since_presentation +
+        (since_presentation / refresh_ns + 1) * refresh_ns;
+
+    /* the last frame has been presented since its repaint. If it took too
+     * long, the output was idle and the presentation is of the restart */
+    int64_t latency = presented - repaint_start_ns;
+    if (repaint_start_ns > 0 && latency > 0 && latency < 4 * refresh_ns)
+    {
+        latency_sum_ms += latency / 1e6;
+        ++latency_frames;
+    }
+    repaint_start_ns = weston_now_ns;
+
+    /* animations sample this time in the effects and renderers of the frame */
+    painted_frame_time = predicted_presentation_ns;
+    if (frame_hooks.empty())
+        return;
+
+    timespec presentation;
+    presentation.tv_sec = predicted_presentation_ns / 1000000000ll;
+    presentation.tv_nsec = predicted_presentation_ns % 1000000000ll;
+
+    /* hooks can remove themselves, so run a snapshot of the list */
+    auto& hooks = frame_scratch.frame_hooks;
+    hooks.assign(frame_hooks.begin(), frame_hooks.end());
+
+    for (auto hook : hooks)
+    {
+        profiler::scope scope(hook, profiler::HOOK_FRAME);
+        (*hook)(presentation);
+    }
+
+    hooks.clear();
 }
 
 void render_manager::reset_renderer()
 {
     renderer = nullptr;
+    renderer_reports_damage = false;
 
     weston_output_damage(output->handle);
     weston_output_schedule_repaint(output->handle);
 }
 
-void render_manager::set_renderer(render_hook_t rh)
+void render_manager::set_renderer(render_hook_t rh, bool reports_damage)
 {
+    profiler::set_hook_owner(&renderer);
+
+    /* several plugins can share the renderer, e.g animations of different views.
+     * Partial repaints are safe only if all of them report their damage */
+    if (renderer)
+        renderer_reports_damage = renderer_reports_damage && reports_damage;
+    else
+        renderer_reports_damage = reports_damage;
+
     if (!rh) {
         renderer = std::bind(std::mem_fn(&render_manager::transformation_renderer), this);
     } else {
@@ -211,11 +424,143 @@ void render_manager::set_renderer(render_hook_t rh)
     }
 }
 
+void render_manager::damage(const weston_geometry& box)
+{
+    pixman_region32_union_rect(&pending_damage, &pending_damage,
+            box.x, box.y, box.width, box.height);
+    weston_output_schedule_repaint(output->handle);
+}
+
+void render_manager::damage(pixman_region32_t *region)
+{
+    pixman_region32_union(&pending_damage, &pending_damage, region);
+    weston_output_schedule_repaint(output->handle);
+}
+
+bool render_manager::update_repaint_region(pixman_region32_t *damage, int buffer_age)
+{
+    auto og = output->get_full_geometry();
+
+    for (int i = damage_history_size - 1; i > 0; i--)
+        pixman_region32_copy(&damage_history[i], &damage_history[i - 1]);
+
+    auto& current = damage_history[0];
+    pixman_region32_union(&current, damage, &pending_damage);
+    pixman_region32_intersect_rect(&current, &current, og.x, og.y, og.width, og.height);
+    pixman_region32_clear(&pending_damage);
+
+    damage_history_frames = std::min(damage_history_frames + 1, damage_history_size);
+
+    /* age 0 means the buffer contents are undefined */
+    if (buffer_age <= 0 || buffer_age > damage_history_frames)
+    {
+        pixman_region32_fini(&repaint_region);
+        pixman_region32_init_rect(&repaint_region, og.x, og.y, og.width, og.height);
+        return false;
+    }
+
+    pixman_region32_copy(&repaint_region, &current);
+    for (int i = 1; i < buffer_age; i++)
+        pixman_region32_union(&repaint_region, &repaint_region, &damage_history[i]);
+
+    /* rendering is scissored to a single box, so repaint all of it */
+    auto extents = *pixman_region32_extents(&repaint_region);
+    pixman_region32_fini(&repaint_region);
+    pixman_region32_init_rect(&repaint_region, extents.x1, extents.y1,
+            extents.x2 - extents.x1, extents.y2 - extents.y1);
+
+    return true;
+}
+
+/* EGL_EXT_buffer_age and swap_buffers_with_damage are optional. All outputs
+ * share the same EGLDisplay, so look them up only once */
+static struct
+{
+    bool initialized = false;
+    bool buffer_age = false;
+    PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swap_with_damage = nullptr;
+} egl_damage_ext;
+
+static bool egl_has_extension(const char *extensions, const char *name)
+{
+    size_t len = std::strlen(name);
+    const char *pos = extensions;
+    while ((pos = std::strstr(pos, name)))
+    {
+        if ((pos == extensions || pos[-1] == ' ') && (pos[len] == ' ' || pos[len] == 0))
+            return true;
+        pos += len;
+    }
+
+    return false;
+}
+
+static void init_egl_damage_ext(EGLDisplay display)
+{
+    if (egl_damage_ext.initialized)
+        return;
+    egl_damage_ext.initialized = true;
+
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions)
+        return;
+
+    egl_damage_ext.buffer_age = egl_has_extension(extensions, "EGL_EXT_buffer_age");
+
+    /* both variants have the same signature */
+    if (egl_has_extension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+    {
+        egl_damage_ext.swap_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    } else if (egl_has_extension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+    {
+        egl_damage_ext.swap_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    }
+
+    info << "EGL buffer age: " << egl_damage_ext.buffer_age << ", swap with damage: "
+        << (egl_damage_ext.swap_with_damage != nullptr) << std::endl;
+}
+
+/* pass the changed rectangles to the swap if possible, so that the parent
+ * compositor or the display controller don't have to process the whole buffer.
+ * damage is nullptr if the whole output changed */
+static void swap_buffers(EGLDisplay display, EGLSurface surface,
+        pixman_region32_t *damage, const weston_geometry& og)
+{
+    if (!damage || !egl_damage_ext.swap_with_damage)
+    {
+        eglSwapBuffers(display, surface);
+        return;
+    }
+
+    /* reused between frames */
+    static std::vector<EGLint> rects;
+
+    int n_boxes;
+    auto boxes = pixman_region32_rectangles(damage, &n_boxes);
+
+    rects.resize(4 * n_boxes);
+    for (int i = 0; i < n_boxes; i++)
+    {
+        /* EGL surface coordinates start in the bottom-left corner */
+        rects[4 * i + 0] = boxes[i].x1 - og.x;
+        rects[4 * i + 1] = og.height - (boxes[i].y2 - og.y);
+        rects[4 * i + 2] = boxes[i].x2 - boxes[i].x1;
+        rects[4 * i + 3] = boxes[i].y2 - boxes[i].y1;
+    }
+
+    egl_damage_ext.swap_with_damage(display, surface, rects.data(), n_boxes);
+}
+
 void render_manager::paint(pixman_region32_t *damage)
 {
-    if (dirty_context)
+    tracing::span span("paint", output->handle->id);
+    if (dirty_context && renderer_api)
         load_context();
 
+    run_frame_hooks();
+
     if (streams_running)
     {
         pixman_region32_union(&frame_damage,
@@ -223,7 +568,7 @@ void render_manager::paint(pixman_region32_t *damage)
         pixman_region32_copy(&prev_damage, &core->ec->primary_plane.damage);
     }
 
-    if (renderer)
+    if (renderer && renderer_api)
     {
         EGLSurface surf = renderer_api->output_get_egl_surface(output->handle);
         EGLContext context = renderer_api->compositor_get_egl_context(core->ec);
@@ -231,60 +576,181 @@ void render_manager::paint(pixman_region32_t *damage)
 
         eglMakeCurrent(display, surf, surf, context);
 
-        GL_CALL(glViewport(0, 0, output->handle->width, output->handle->height));
-
         OpenGL::bind_context(ctx);
-        renderer();
+        OpenGL::set_viewport(0, 0, output->handle->width, output->handle->height);
 
+        /* the scissor box is computed for untransformed outputs only */
+        init_egl_damage_ext(display);
+        EGLint buffer_age = 0;
+        if (renderer_reports_damage && egl_damage_ext.buffer_age &&
+                output->get_transform() == WL_OUTPUT_TRANSFORM_NORMAL)
+        {
+            eglQuerySurface(display, surf, EGL_BUFFER_AGE_EXT, &buffer_age);
+        }
+
+        auto og = output->get_full_geometry();
+        bool partial = update_repaint_region(damage, buffer_age);
+        if (partial)
+        {
+            auto box = pixman_region32_extents(&repaint_region);
+            GL_CALL(glEnable(GL_SCISSOR_TEST));
+            GL_CALL(glScissor(box->x1 - og.x, og.height - (box->y2 - og.y),
+                        box->x2 - box->x1, box->y2 - box->y1));
+        }
+
+        int64_t renderer_start = frame_clock_now();
+        {
+            profiler::scope scope(&renderer, profiler::HOOK_RENDERER);
+            tracing::span span("renderer", output->handle->id);
+            renderer();
+        }
+
+        int64_t effects_start = frame_clock_now();
         run_effects();
 
+        metrics.renderer.record((effects_start - renderer_start) / 1000);
+        metrics.effects.record((frame_clock_now() - effects_start) / 1000);
+
+        if (partial)
+            GL_CALL(glDisable(GL_SCISSOR_TEST));
+
+        report_render_stats();
+        OpenGL::check_frame_errors();
+
         wl_signal_emit(&output->handle->frame_signal, output->handle);
-        eglSwapBuffers(display, surf);
+
+        int64_t swap_start = frame_clock_now();
+        {
+            tracing::span span("swap_buffers", output->handle->id);
+            swap_buffers(display, surf, partial ? &damage_history[0] : nullptr, og);
+        }
+        metrics.swap.record((frame_clock_now() - swap_start) / 1000);
     } else {
+        /* weston repaints on its own, but its frames still count for the buffer age */
+        update_repaint_region(damage, 0);
+
+        int64_t renderer_start = frame_clock_now();
         core->weston_repaint(output->handle, damage);
-        run_effects();
+
+        int64_t effects_start = frame_clock_now();
+        if (renderer_api)
+            run_effects();
+
+        metrics.renderer.record((effects_start - renderer_start) / 1000);
+        metrics.effects.record((frame_clock_now() - effects_start) / 1000);
     }
 
-    if (constant_redraw)
+    if (wants_next_frame())
+        schedule_next_frame();
+    core->hijack_renderer();
+
+    reset_frame_scratch();
+    painted_frame_time = -1;
+
+    record_render_time();
+}
+
+void render_manager::record_render_time()
+{
+    int64_t now = frame_clock_now();
+
+    frame_done_signal frame_data;
+    frame_data.paint_time = (now - frame_start_ns) / 1000;
+    frame_data.missed_deadline = now > predicted_presentation_ns;
+
+    metrics.paint.record(frame_data.paint_time);
+    if (frame_data.missed_deadline)
+        ++metrics.missed_deadlines;
+    output->signal->emit<wf_signal::frame_done>(&frame_data);
+
+    const int64_t metrics_window = 5000000000ll;
+    if (now - metrics_window_start >= metrics_window)
     {
-        wl_event_loop_add_idle(wl_display_get_event_loop(core->ec->wl_display),
-                redraw_idle_cb, output);
+        metrics.end_window();
+        send_frame_stats();
+        metrics_window_start = now;
     }
-    core->hijack_renderer();
+
+    render_times[render_time_pos] = (now - frame_start_ns) / 1e6;
+    render_time_pos = (render_time_pos + 1) % render_time_samples;
+    render_time_count = std::min(render_time_count + 1, render_time_samples);
+
+    /* the percentile is recomputed only every few frames */
+    const int update_interval = 32;
+    if (render_time_pos % update_interval)
+        return;
+
+    std::copy(render_times, render_times + render_time_count, render_times_scratch);
+    auto p95 = render_times_scratch + render_time_count * 95 / 100;
+    std::nth_element(render_times_scratch, p95, render_times_scratch + render_time_count);
+    render_time_p95 = *p95;
+
+    if (core->adaptive_repaint_delay)
+        core->update_repaint_delay();
 }
 
-void render_manager::run_effects()
+void render_manager::send_frame_stats()
 {
-    std::vector<effect_hook_t*> active_effects;
-    for (auto effect : output_effects)
-        active_effects.push_back(effect);
+    if (!core->wf_shell.client || wl_resource_get_version(core->wf_shell.resource) <
+            WAYFIRE_SHELL_FRAME_STATS_SINCE_VERSION)
+    {
+        return;
+    }
 
-    for (auto& effect : active_effects)
-        (*effect)();
+    wayfire_shell_send_frame_stats(core->wf_shell.resource, output->handle->id,
+            metrics.paint.count, metrics.missed_deadlines,
+            metrics.paint.quantile(0.5), metrics.paint.quantile(0.99),
+            metrics.interval.quantile(0.99));
 }
 
-void render_manager::transformation_renderer()
+void render_manager::report_render_stats()
 {
-    auto views = output->workspace->get_renderable_views_on_workspace(
-            output->workspace->get_current_workspace());
+    const int report_interval = 1000;
+    if (++stats_frames < report_interval)
+        return;
 
-    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+    debug << "output " << output->handle->id << ": "
+        << 1.0 * ctx->stats.draw_calls / stats_frames << " draw calls, "
+        << 1.0 * ctx->stats.quads / stats_frames << " quads per frame" << std::endl;
+
+    auto& rt = render_target_stats;
+    uint64_t requests = rt.hits + rt.misses;
+    debug << "output " << output->handle->id << ": render target pool: "
+        << (requests ? 100.0 * rt.hits / requests : 0) << "% hit rate, "
+        << rt.evictions << " evictions, " << (rt.resident_bytes >> 20)
+        << "MB in " << render_target_pool.size() << " targets" << std::endl;
+
+    debug << "output " << output->handle->id << ": render time p95 "
+        << render_time_p95 << "ms, repaint delay " << core->ec->repaint_msec
+        << "ms, repaint to presentation " << latency_sum_ms / std::max(latency_frames, 1)
+        << "ms" << std::endl;
+
+    latency_sum_ms = 0;
+    latency_frames = 0;
+    stats_frames = 0;
+    ctx->stats.draw_calls = ctx->stats.quads = 0;
+}
 
-    auto it = views.rbegin();
-    while (it != views.rend())
-    {
-        auto view = *it;
-        if (!view->is_hidden) /* use is_visible() when implemented */
-        {
-            view->render();
-        }
+void render_manager::run_effects()
+{
+    tracing::span span("run_effects", output->handle->id);
 
-        ++it;
+    /* effects can remove themselves or others, so run a snapshot of the list */
+    auto& active_effects = frame_scratch.effects;
+    active_effects.assign(output_effects.begin(), output_effects.end());
+
+    for (auto effect : active_effects)
+    {
+        profiler::scope scope(effect, profiler::HOOK_EFFECT);
+        (*effect)();
     }
+
+    active_effects.clear();
 }
 
 void render_manager::add_output_effect(effect_hook_t* hook, wayfire_view v)
 {
+    profiler::set_hook_owner(hook);
     if (v)
         v->effects.push_back(hook);
     else
@@ -293,6 +759,7 @@ void render_manager::add_output_effect(effect_hook_t* hook, wayfire_view v)
 
 void render_manager::rem_effect(const effect_hook_t *hook, wayfire_view v)
 {
+    profiler::forget_hook(hook);
     if (v)
     {
         auto it = std::remove_if(v->effects.begin(), v->effects.end(),
@@ -318,16 +785,94 @@ void render_manager::rem_effect(const effect_hook_t *hook, wayfire_view v)
     }
 }
 
+wf_render_target render_manager::acquire_render_target(int width, int height,
+        bool rgb565)
+{
+    for (auto& entry : render_target_pool)
+    {
+        if (!entry.in_use && entry.target.width == width &&
+                entry.target.height == height && entry.target.rgb565 == rgb565)
+        {
+            ++render_target_stats.hits;
+            entry.in_use = true;
+            return entry.target;
+        }
+    }
+
+    ++render_target_stats.misses;
+
+    wf_render_target target;
+    target.width = width;
+    target.height = height;
+    target.rgb565 = rgb565;
+    OpenGL::prepare_framebuffer_size(target.fbuff, target.tex, width, height,
+            rgb565 ? GL_RGB565 : GL_RGBA);
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    size_t bytes = (rgb565 ? 2ul : 4ul) * width * height;
+    render_target_pool.push_back({target, bytes, true, 0});
+    render_target_stats.resident_bytes += bytes;
+
+    /* free targets might have to make room for the new one */
+    evict_render_targets();
+    return target;
+}
+
+void render_manager::release_render_target(wf_render_target& target)
+{
+    for (auto& entry : render_target_pool)
+    {
+        if (entry.in_use && entry.target.fbuff == target.fbuff)
+        {
+            entry.in_use = false;
+            entry.last_used = ++render_target_clock;
+            break;
+        }
+    }
+
+    target = wf_render_target();
+    evict_render_targets();
+}
+
+void render_manager::evict_render_targets()
+{
+    while (render_target_stats.resident_bytes > render_target_budget)
+    {
+        auto lru = render_target_pool.end();
+        for (auto it = render_target_pool.begin(); it != render_target_pool.end(); ++it)
+        {
+            if (!it->in_use && (lru == render_target_pool.end() ||
+                        it->last_used < lru->last_used))
+                lru = it;
+        }
+
+        /* everything is in use, we can't do anything */
+        if (lru == render_target_pool.end())
+            return;
+
+        GL_CALL(glDeleteFramebuffers(1, &lru->target.fbuff));
+        GL_CALL(glDeleteTextures(1, &lru->target.tex));
+
+        render_target_stats.resident_bytes -= lru->bytes;
+        ++render_target_stats.evictions;
+        render_target_pool.erase(lru);
+    }
+}
+
 void render_manager::texture_from_workspace(std::tuple<int, int> vp,
-        GLuint &fbuff, GLuint &tex)
+        wf_render_target& target)
 {
     OpenGL::bind_context(output->render->ctx);
 
-    if (fbuff == (uint)-1 || tex == (uint)-1)
-        OpenGL::prepare_framebuffer(fbuff, tex);
+    if (target.width != output->handle->width || target.height != output->handle->height)
+    {
+        if (target.fbuff != (uint)-1)
+            release_render_target(target);
+        target = acquire_render_target(output->handle->width, output->handle->height);
+    }
 
-    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbuff));
-    GL_CALL(glViewport(0, 0, output->handle->width, output->handle->height));
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.fbuff));
+    OpenGL::set_viewport(0, 0, output->handle->width, output->handle->height);
 
     auto g = output->get_full_geometry();
 
@@ -342,7 +887,7 @@ void render_manager::texture_from_workspace(std::tuple<int, int> vp,
 
     while (it != views.rend())
     {
-        auto v = *it;
+        auto& v = *it;
         if (v->is_visible())
         {
             if (!v->is_special)
@@ -365,20 +910,26 @@ void render_manager::texture_from_workspace(std::tuple<int, int> vp,
     GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
-void render_manager::workspace_stream_start(wf_workspace_stream *stream)
+void render_manager::workspace_stream_start(wf_workspace_stream *stream,
+        float scale_x, float scale_y)
 {
     streams_running++;
     stream->running = true;
-    stream->scale_x = stream->scale_y = 1;
+    stream->scale_x = scale_x;
+    stream->scale_y = scale_y;
 
     OpenGL::bind_context(output->render->ctx);
+    ensure_stream_buffer(stream);
 
-    if (stream->fbuff == (uint)-1 || stream->tex == (uint)-1)
-        OpenGL::prepare_framebuffer(stream->fbuff, stream->tex);
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stream->buffer.fbuff));
+    OpenGL::set_viewport(0, 0, output->handle->width * stream->scale_x,
+                output->handle->height * stream->scale_y);
 
-    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stream->fbuff));
-    GL_CALL(glViewport(0, 0, output->handle->width * stream->scale_x,
-                output->handle->height * stream->scale_y));
+    /* render in the bottom-left corner of the buffer, as big as the scale says */
+    glm::mat4 scale = glm::scale(glm::mat4(), glm::vec3(scale_x, scale_y, 1));
+    glm::mat4 translate = glm::translate(glm::mat4(), glm::vec3(scale_x - 1, scale_y - 1, 0));
+    std::swap(wayfire_view_transform::global_scale, scale);
+    std::swap(wayfire_view_transform::global_translate, translate);
 
     GetTuple(x, y, stream->ws);
     GetTuple(cx, cy, output->workspace->get_current_workspace());
@@ -394,7 +945,7 @@ void render_manager::workspace_stream_start(wf_workspace_stream *stream)
 
     while (it != views.rend())
     {
-        auto v = *it;
+        auto& v = *it;
         if (v->is_visible())
         {
             if (!v->is_special)
@@ -412,6 +963,9 @@ void render_manager::workspace_stream_start(wf_workspace_stream *stream)
         ++it;
     };
 
+    std::swap(wayfire_view_transform::global_scale, scale);
+    std::swap(wayfire_view_transform::global_translate, translate);
+
     GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
@@ -424,100 +978,176 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
     GetTuple(x, y, stream->ws);
     GetTuple(cx, cy, output->workspace->get_current_workspace());
 
+    /* the id is the index of the workspace */
+    tracing::span span("workspace_stream_update", y * core->vwidth + x);
+
     int dx = g.x + (x - cx) * g.width,
         dy = g.y + (y - cy) * g.height;
 
-    pixman_region32_t ws_damage;
-    pixman_region32_init_rect(&ws_damage, dx, dy, g.width, g.height);
-    pixman_region32_intersect(&ws_damage, &frame_damage, &ws_damage);
+    auto& ws_damage = frame_scratch.ws_damage;
+    pixman_region32_intersect_rect(&ws_damage, &frame_damage, dx, dy, g.width, g.height);
 
     /* we don't have to update anything */
     if (!pixman_region32_not_empty(&ws_damage))
-    {
-        pixman_region32_fini(&ws_damage);
         return;
-    }
 
-    if (scale_x != stream->scale_x || scale_y != stream->scale_y)
-    {
-        stream->scale_x = scale_x;
-        stream->scale_y = scale_y;
+    bool scale_changed = (scale_x != stream->scale_x || scale_y != stream->scale_y);
+    stream->scale_x = scale_x;
+    stream->scale_y = scale_y;
 
+    if (ensure_stream_buffer(stream) || scale_changed)
+    {
         pixman_region32_union_rect(&ws_damage, &ws_damage, dx, dy,
                 g.width, g.height);
     }
 
-    auto views = output->workspace->get_renderable_views_on_workspace(stream->ws);
+    collect_damaged_views(stream->ws, &ws_damage, dx, dy);
 
-    struct damaged_view {
-        wayfire_view view;
-        pixman_region32_t *damage;
-    };
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stream->buffer.fbuff));
+    OpenGL::set_viewport(0, 0, output->handle->width * stream->scale_x,
+                output->handle->height * stream->scale_y);
 
-    std::vector<damaged_view> update_views;
+    /* render in the bottom-left corner of the buffer, as big as the scale says */
+    glm::mat4 scale = glm::scale(glm::mat4(), glm::vec3(scale_x, scale_y, 1));
+    glm::mat4 translate = glm::translate(glm::mat4(), glm::vec3(scale_x - 1, scale_y - 1, 0));
+    std::swap(wayfire_view_transform::global_scale, scale);
+    std::swap(wayfire_view_transform::global_translate, translate);
 
-    auto it = views.begin();
+    GetTuple(x, y, stream->ws);
+    GetTuple(cx, cy, output->workspace->get_current_workspace());
 
-    while (it != views.end() && pixman_region32_not_empty(&ws_damage))
-    {
-        damaged_view dv;
-        dv.view = *it;
+    /* TODO: this assumes we use viewports arranged in a grid
+     * It would be much better to actually ask the workspace_manager
+     * for view's position on the given workspace*/
+    int dx = (cx - x)  * output->handle->width,
+        dy = (cy - y)  * output->handle->height;
+
+    auto views = output->workspace->get_renderable_views_on_workspace(stream->ws);
+    auto it = views.rbegin();
 
-        if (dv.view->is_visible())
+    while (it != views.rend())
+    {
+        auto& v = *it;
+        if (v->is_visible())
         {
-            dv.damage = new pixman_region32_t;
-            if (dv.view->is_special)
+            if (!v->is_special)
             {
-                /* make background's damage be at the target viewport */
-                pixman_region32_init_rect(dv.damage,
-                    dv.view->geometry.x - dv.view->ds_geometry.x + (dx - g.x),
-                    dv.view->geometry.y - dv.view->ds_geometry.y + (dy - g.y),
-                    dv.view->surface->width, dv.view->surface->height);
+                v->geometry.x += dx;
+                v->geometry.y += dy;
+                v->render();
+                v->geometry.x -= dx;
+                v->geometry.y -= dy;
             } else
             {
-                pixman_region32_init_rect(dv.damage,
-                        dv.view->geometry.x - dv.view->ds_geometry.x,
-                        dv.view->geometry.y - dv.view->ds_geometry.y,
-                        dv.view->surface->width, dv.view->surface->height);
-            }
-
-            pixman_region32_intersect(dv.damage, dv.damage, &ws_damage);
-            if (pixman_region32_not_empty(dv.damage)) {
-                update_views.push_back(dv);
-                /* If we are processing background, then this is not correct, as its
-                 * transform.opaque isn't positioned properly. But as
-                 * background is the last in the list, we don' care */
-                pixman_region32_subtract(&ws_damage, &ws_damage, &dv.view->handle->transform.opaque);
-            } else {
-                pixman_region32_fini(dv.damage);
-                delete dv.damage;
+                v->render();
             }
         }
         ++it;
     };
 
-    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stream->fbuff));
-    GL_CALL(glViewport(0, 0, g.width * scale_x, g.height * scale_y));
+    std::swap(wayfire_view_transform::global_scale, scale);
+    std::swap(wayfire_view_transform::global_translate, translate);
+
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void render_manager::workspace_stream_update(wf_workspace_stream *stream,
+                                             float scale_x, float scale_y)
+{
+    OpenGL::bind_context(output->render->ctx);
+    auto g = output->get_full_geometry();
+
+    GetTuple(x, y, stream->ws);
+    GetTuple(cx, cy, output->workspace->get_current_workspace());
+
+    /* the id is the index of the workspace */
+    tracing::span span("workspace_stream_update", y * core->vwidth + x);
+
+    int dx = g.x + (x - cx) * g.width,
+        dy = g.y + (y - cy) * g.height;
+
+    auto& ws_damage = frame_scratch.ws_damage;
+    pixman_region32_intersect_rect(&ws_damage, &frame_damage, dx, dy, g.width, g.height);
+
+    /* we don't have to update anything */
+    if (!pixman_region32_not_empty(&ws_damage))
+        return;
+
+    bool scale_changed = (scale_x != stream->scale_x || scale_y != stream->scale_y);
+    stream->scale_x = scale_x;
+    stream->scale_y = scale_y;
+
+    if (ensure_stream_buffer(stream) || scale_changed)
+    {
+        pixman_region32_union_rect(&ws_damage, &ws_damage, dx, dy,
+                g.width, g.height);
+    }
+
+    auto& views = frame_scratch.views;
+    output->workspace->get_renderable_views_on_workspace(stream->ws, views);
+
+    /* streams are updated one after another, so they can share the scratch lists */
+    frame_scratch.damaged_views_count = 0;
+
+    auto it = views.begin();
+    while (it != views.end() && pixman_region32_not_empty(&ws_damage))
+    {
+        auto view = *it;
+        ++it;
+
+        if (!view->is_visible())
+            continue;
+
+        auto& dv = next_damaged_view();
+        dv.view = view;
+
+        if (view->is_special)
+        {
+            /* make background's damage be at the target viewport */
+            pixman_region32_intersect_rect(&dv.damage, &ws_damage,
+                view->geometry.x - view->ds_geometry.x + (dx - g.x),
+                view->geometry.y - view->ds_geometry.y + (dy - g.y),
+                view->surface->width, view->surface->height);
+        } else
+        {
+            pixman_region32_intersect_rect(&dv.damage, &ws_damage,
+                    view->geometry.x - view->ds_geometry.x,
+                    view->geometry.y - view->ds_geometry.y,
+                    view->surface->width, view->surface->height);
+        }
+
+        if (pixman_region32_not_empty(&dv.damage)) {
+            /* If we are processing background, then this is not correct, as its
+             * transform.opaque isn't positioned properly. But as
+             * background is the last in the list, we don' care */
+            pixman_region32_subtract(&ws_damage, &ws_damage, &view->handle->transform.opaque);
+        } else {
+            /* give the entry back */
+            --frame_scratch.damaged_views_count;
+        }
+    };
+
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, stream->buffer.fbuff));
+    OpenGL::set_viewport(0, 0, g.width * scale_x, g.height * scale_y);
 
     glm::mat4 scale = glm::scale(glm::mat4(), glm::vec3(scale_x, scale_y, 1));
     glm::mat4 translate = glm::translate(glm::mat4(), glm::vec3(scale_x - 1, scale_y - 1, 0));
     std::swap(wayfire_view_transform::global_scale, scale);
     std::swap(wayfire_view_transform::global_translate, translate);
 
-    auto rev_it = update_views.rbegin();
-    while(rev_it != update_views.rend())
+    for (int i = (int)frame_scratch.damaged_views_count - 1; i >= 0; i--)
     {
-        auto dv = *rev_it;
+        auto& dv = frame_scratch.damaged_views[i];
 
 #define render_op(dx, dy) \
         dv.view->geometry.x -= dx; \
         dv.view->geometry.y -= dy; \
-        dv.view->render(0, dv.damage); \
+        dv.view->render(0, &dv.damage); \
         dv.view->geometry.x += dx; \
         dv.view->geometry.y += dy;
 
 
-        pixman_region32_translate(dv.damage, -(dx - g.x), -(dy - g.y));
+        pixman_region32_translate(&dv.damage, -(dx - g.x), -(dy - g.y));
         if (dv.view->is_special)
         {
             render_op(0, 0);
@@ -525,55 +1155,57 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
         {
             render_op(dx - g.x, dy - g.y);
         }
-
-        pixman_region32_fini(dv.damage);
-        delete dv.damage;
-        ++rev_it;
     }
 
+    frame_scratch.damaged_views_count = 0;
+
     std::swap(wayfire_view_transform::global_scale, scale);
     std::swap(wayfire_view_transform::global_translate, translate);
 
     GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-    pixman_region32_fini(&ws_damage);
 }
 
 void render_manager::workspace_stream_stop(wf_workspace_stream *stream)
 {
     streams_running--;
     stream->running = false;
-}
 
-/* End render_manager */
-
-/* Start SignalManager */
+    release_render_target(stream->buffer);
+}
 
-void signal_manager::connect_signal(std::string name, signal_callback_t* callback)
+/* Buffers are allocated in steps of 1/8 of the output size, so that
+ * streams which are being zoomed don't need a new buffer every frame */
+static int get_stream_buffer_size(int output_size, float scale)
 {
-    sig[name].push_back(callback);
+    const float steps = 8;
+    float step = std::ceil(std::min(std::max(scale, 0.f), 1.f) * steps) / steps;
+    return std::max(1, (int)std::ceil(output_size * std::max(step, 1 / steps)));
 }
 
-void signal_manager::disconnect_signal(std::string name, signal_callback_t* callback)
+/* the output might have been resized or the scale changed since the stream was started */
+bool render_manager::ensure_stream_buffer(wf_workspace_stream *stream)
 {
-    auto it = std::remove_if(sig[name].begin(), sig[name].end(),
-    [=] (const signal_callback_t *call) {
-        return call == callback;
-    });
+    auto& buffer = stream->buffer;
+    int width = get_stream_buffer_size(output->handle->width, stream->scale_x);
+    int height = get_stream_buffer_size(output->handle->height, stream->scale_y);
 
-    sig[name].erase(it, sig[name].end());
-}
+    bool reallocated = false;
+    if (buffer.width != width || buffer.height != height || buffer.rgb565 != stream->rgb565)
+    {
+        if (buffer.fbuff != (uint)-1)
+            release_render_target(buffer);
 
-void signal_manager::emit_signal(std::string name, signal_data *data)
-{
-    std::vector<signal_callback_t> callbacks;
-    for (auto x : sig[name])
-        callbacks.push_back(*x);
+        buffer = acquire_render_target(width, height, stream->rgb565);
+        reallocated = true;
+    }
 
-    for (auto x : callbacks)
-        x(data);
+    stream->tex_x2 = std::min(1.f, output->handle->width * stream->scale_x / width);
+    stream->tex_y2 = std::min(1.f, output->handle->height * stream->scale_y / height);
+    return reallocated;
 }
 
-/* End SignalManager */
+/* End render_manager */
+
 /* Start output */
 wayfire_output* wl_output_to_wayfire_output(uint32_t output)
 {
@@ -716,12 +1348,15 @@ void wayfire_output::set_transform(wl_output_transform new_tr)
     int old_h = handle->height;
     weston_output_set_transform(handle, new_tr);
 
-    render->ctx->width = handle->width;
-    render->ctx->height = handle->height;
+    if (render->ctx)
+    {
+        render->ctx->width = handle->width;
+        render->ctx->height = handle->height;
+    }
 
     wayfire_shell_send_output_resized(core->wf_shell.resource, handle->id,
 		    handle->width, handle->height);
-    signal->emit_signal("output-resized", nullptr);
+    signal->emit<wf_signal::output_resized>(nullptr);
 
     //ensure_pointer();
 
@@ -798,13 +1433,13 @@ void wayfire_output::attach_view(wayfire_view v)
     workspace->view_bring_to_front(v);
 
     auto sig_data = create_view_signal{v};
-    signal->emit_signal("attach-view", &sig_data);
+    signal->emit<wf_signal::attach_view>(&sig_data);
 }
 
 void wayfire_output::detach_view(wayfire_view v)
 {
     auto sig_data = destroy_view_signal{v};
-    signal->emit_signal("detach-view", &sig_data);
+    signal->emit<wf_signal::detach_view>(&sig_data);
 
     if (v->keep_count <= 0)
         workspace->view_removed(v);
@@ -878,7 +1513,7 @@ void wayfire_output::focus_view(wayfire_view v, weston_seat *seat)
 
     focus_view_signal data;
     data.focus = v;
-    signal->emit_signal("focus-view", &data);
+    signal->emit<wf_signal::focus_view>(&data);
 }
 
 wayfire_view wayfire_output::get_top_view()
@@ -897,16 +1532,7 @@ wayfire_view wayfire_output::get_top_view()
 
 wayfire_view wayfire_output::get_view_at_point(int x, int y)
 {
-    wayfire_view chosen = nullptr;
-
-    workspace->for_each_view([x, y, &chosen] (wayfire_view v) {
-        if (v->is_visible() && point_inside({x, y}, v->geometry)) {
-            if (chosen == nullptr)
-                chosen = v;
-        }
-    });
-
-    return chosen;
+    return workspace->get_view_at_point(x, y);
 }
 
 bool wayfire_output::activate_plugin(wayfire_grab_interface owner, bool lower_fs)
@@ -3,6 +3,7 @@
 
 #include "view.hpp"
 #include "plugin.hpp"
+#include "metrics.hpp"
 #include <vector>
 #include <unordered_map>
 #include <pixman-1/pixman.h>
@@ -10,6 +11,7 @@
 
 namespace OpenGL {
     struct context_t;
+    struct texture_quad;
 }
 struct weston_seat;
 struct weston_output;
@@ -18,14 +20,29 @@ struct plugin_manager;
 
 class workspace_manager;
 
+/* A framebuffer with an attached texture, see render_manager::acquire_render_target()
+ * The texture is RGBA, or RGB565 if rgb565 is set */
+struct wf_render_target {
+    uint fbuff = -1, tex = -1;
+    int width = 0, height = 0;
+    bool rgb565 = false;
+};
+
 /* Workspace streams are used if you need to continuously render a workspace
- * to a texture, for example if you call texture_from_viewport at every frame */
+ * to a texture, for example if you call texture_from_viewport at every frame.
+ * The buffer is taken from the render target pool only while the stream is running,
+ * and it is only as big as needed for the current scale */
 struct wf_workspace_stream {
     std::tuple<int, int> ws;
-    uint fbuff, tex;
+    wf_render_target buffer;
     bool running = false;
 
     float scale_x, scale_y;
+    /* the part of buffer.tex which contains the workspace, in texture coordinates */
+    float tex_x2 = 1, tex_y2 = 1;
+
+    /* use a 16-bit texture, for example for thumbnails */
+    bool rgb565 = false;
 };
 
 struct render_manager {
@@ -33,40 +50,202 @@ struct render_manager {
         wayfire_output *output;
         int constant_redraw = 0;
 
+        /* Frame scheduling: while hooks are registered or auto_redraw is on,
+         * frame_animation is in weston's animation list of the output. weston
+         * calls it after each repaint, and it requests the next one, which
+         * weston starts repaint_msec before the vblank after the presentation */
+        std::vector<frame_hook_t*> frame_hooks;
+        weston_animation frame_animation;
+        bool frame_animation_active = false;
+        /* the predicted presentation time of the current frame */
+        int64_t predicted_presentation_ns = 0;
+
+        bool wants_next_frame();
+        void schedule_next_frame();
+        /* the time argument is different between libweston versions, and isn't used */
+        template<class T>
+        static void frame_animation_cb(weston_animation*, weston_output*, T);
+        /* predict when the frame will be presented and run the frame hooks */
+        void run_frame_hooks();
+
         bool dirty_context = true;
 
         void load_context();
         void release_context();
 
         render_hook_t renderer;
+        /* if false, the renderer repaints the whole output each frame */
+        bool renderer_reports_damage = false;
 
         pixman_region32_t frame_damage, prev_damage;
+
+        /* damage reported by plugins since the last frame */
+        pixman_region32_t pending_damage;
+        /* damage of the last frames, newest first. A back buffer which is
+         * N frames old (EGL_EXT_buffer_age) misses the first N entries */
+        static const int damage_history_size = 4;
+        pixman_region32_t damage_history[damage_history_size];
+        int damage_history_frames = 0;
+        /* the part of the output repainted in the current frame */
+        pixman_region32_t repaint_region;
+
+        /* returns false if the whole output has to be repainted */
+        bool update_repaint_region(pixman_region32_t *damage, int buffer_age);
         int streams_running = 0;
 
+        /* Containers which are reused between frames, so that rendering doesn't
+         * allocate memory in the steady state. They are reset at the end of paint() */
+        struct damaged_view
+        {
+            /* keeps the view alive, if it is destroyed by a plugin during the frame */
+            wayfire_view view;
+            pixman_region32_t damage;
+        };
+
+        struct
+        {
+            std::vector<effect_hook_t*> effects;
+            std::vector<frame_hook_t*> frame_hooks;
+
+            /* the renderable views of the workspace being rendered */
+            std::vector<wayfire_view> views;
+
+            /* the regions of all entries are initialized, only the first
+             * damaged_views_count are used in the current stream update */
+            std::vector<damaged_view> damaged_views;
+            size_t damaged_views_count = 0;
+
+            pixman_region32_t ws_damage;
+            /* not yet covered by opaque views in transformation_renderer() */
+            pixman_region32_t visible;
+
+            /* used by wayfire_view_t::simple_render() for each surface */
+            pixman_region32_t surface_damage;
+            std::vector<OpenGL::texture_quad> quads;
+        } frame_scratch;
+        friend class wayfire_view_t;
+        /* see microbench/render.cpp */
+        friend struct render_benchmark_access;
+
+        damaged_view& next_damaged_view();
+        void reset_frame_scratch();
+
+        /* fill frame_scratch.damaged_views with the visible views of workspace ws
+         * which intersect damage, top to bottom. dx, dy is where the workspace is,
+         * relative to the current one. damage is reduced by their opaque regions */
+        void collect_damaged_views(std::tuple<int, int> ws, pixman_region32_t *damage,
+                int dx, int dy);
+
+        /* periodically log the draw calls per frame */
+        int stats_frames = 0;
+        void report_render_stats();
+
+        /* CPU time of the recent frames, for the adaptive repaint delay */
+        static const int render_time_samples = 128;
+        float render_times[render_time_samples];
+        float render_times_scratch[render_time_samples];
+        int render_time_pos = 0, render_time_count = 0;
+        float render_time_p95 = 0;
+
+        int64_t frame_start_ns = 0;
+        /* time from the start of the repaint to the presentation reported by
+         * weston, both on weston's clock */
+        int64_t repaint_start_ns = 0;
+        double latency_sum_ms = 0;
+        int latency_frames = 0;
+
+        void record_render_time();
+
+        /* the metrics windows end every few seconds, and are sent to the shell */
+        int64_t metrics_window_start = 0;
+        void send_frame_stats();
+
+        /* Render targets which are not in use are kept around for reuse,
+         * until their total size exceeds render_target_budget. Then the
+         * least recently used are freed */
+        struct pooled_render_target
+        {
+            wf_render_target target;
+            size_t bytes;
+            bool in_use;
+            uint64_t last_used;
+        };
+
+        std::vector<pooled_render_target> render_target_pool;
+        size_t render_target_budget;
+        uint64_t render_target_clock = 0;
+
+        struct
+        {
+            uint64_t hits = 0, misses = 0, evictions = 0;
+            size_t resident_bytes = 0;
+        } render_target_stats;
+
+        void evict_render_targets();
+        /* returns true if the buffer was reallocated and has to be redrawn */
+        bool ensure_stream_buffer(wf_workspace_stream *stream);
+
     public:
-        OpenGL::context_t *ctx;
+        /* both are null if weston doesn't use the gl-renderer, e.g the
+         * headless backend, then renderers and effects aren't run */
+        OpenGL::context_t *ctx = nullptr;
     	static const weston_gl_renderer_api *renderer_api;
 
         render_manager(wayfire_output *o);
+        ~render_manager();
 
-        void set_renderer(render_hook_t rh = nullptr);
+        /* A renderer which reports_damage repaints only get_repaint_region(),
+         * and everything which changes outside of weston's knowledge (transforms,
+         * effects) has to be reported with damage() */
+        void set_renderer(render_hook_t rh = nullptr, bool reports_damage = false);
 
         void auto_redraw(bool redraw); /* schedule repaint immediately after finishing the last */
+
+        /* Call the hook before each frame with the predicted presentation time
+         * of that frame. The output keeps repainting while hooks are registered */
+        void add_frame_hook(frame_hook_t*);
+        void rem_frame_hook(const frame_hook_t*);
+
+        /* the clock of frame timestamps, weston's presentation clock by default.
+         * Can be replaced by a fake one, e.g with the headless backend. The real
+         * presentations are mapped to it by how long ago they happened */
+        static std::function<void(timespec*)> frame_clock;
+        /* the refresh period of the current mode, or of 60Hz if unknown */
+        int64_t get_refresh_ns();
+
         void transformation_renderer();
         void reset_renderer();
 
         void paint(pixman_region32_t *damage);
         void run_effects();
 
+        /* 95th percentile of the CPU time of the recent frames, in ms */
+        float get_render_time_p95() { return render_time_p95; }
+        wf_frame_metrics metrics;
+
+        /* mark a part of the output(in global coordinates) for repaint in the next frame */
+        void damage(const weston_geometry& box);
+        void damage(pixman_region32_t *region);
+        /* valid during the renderer, rendering is scissored to its extents */
+        pixman_region32_t* get_repaint_region() { return &repaint_region; }
+
         std::vector<effect_hook_t*> output_effects;
         void add_output_effect(effect_hook_t*, wayfire_view v = nullptr);
         void rem_effect(const effect_hook_t*, wayfire_view v = nullptr);
 
-        /* this function renders a viewport and
-         * saves the image in texture which is returned */
-        void texture_from_workspace(std::tuple<int, int>, uint& fbuff, uint &tex);
+        /* Get a render target with the given size, reusing a free one if possible.
+         * The contents are undefined. Return it with release_render_target() */
+        wf_render_target acquire_render_target(int width, int height, bool rgb565 = false);
+        /* give the target back to the pool and reset it */
+        void release_render_target(wf_render_target& target);
+
+        /* this function renders a viewport and saves the image in target.
+         * If target doesn't have the size of the output, it is (re)acquired
+         * from the pool, so it must be released with release_render_target() */
+        void texture_from_workspace(std::tuple<int, int>, wf_render_target& target);
 
-        void workspace_stream_start(wf_workspace_stream *stream);
+        void workspace_stream_start(wf_workspace_stream *stream,
+                float scale_x = 1, float scale_y = 1);
         void workspace_stream_update(wf_workspace_stream *stream,
                 float scale_x = 1, float scale_y = 1);
         void workspace_stream_stop(wf_workspace_stream *stream);
@@ -84,6 +263,8 @@ class workspace_manager
         /* we could actually attach signal listeners, but this is easier */
         virtual void view_bring_to_front(wayfire_view view) = 0;
         virtual void view_removed(wayfire_view view) = 0;
+        /* called whenever the view's geometry or fullscreen state changes */
+        virtual void view_geometry_changed(wayfire_view view) = 0;
 
         /* return if the view is visible on the given workspace */
         virtual bool view_visible_on(wayfire_view view, std::tuple<int, int>) = 0;
@@ -98,10 +279,13 @@ class workspace_manager
          * it must be guaranteed that if override is set, then the functions returns true */
         virtual bool set_implementation(std::tuple<int, int>, wf_workspace_implementation *, bool override = false) = 0;
 
-        /* toplevel views (i.e windows) on the given workspace */
+        /* toplevel views (i.e windows) on the given workspace, from top to bottom */
         virtual std::vector<wayfire_view>
             get_views_on_workspace(std::tuple<int, int>) = 0;
 
+        /* the topmost toplevel view which contains the given point(in global coordinates) */
+        virtual wayfire_view get_view_at_point(int x, int y) = 0;
+
         virtual void set_workspace(std::tuple<int, int>) = 0;
         virtual std::tuple<int, int> get_current_workspace() = 0;
         virtual std::tuple<int, int> get_workspace_grid_size() = 0;
@@ -113,6 +297,9 @@ class workspace_manager
          * The list must be returned from top to bottom(i.e the last is background) */
         virtual std::vector<wayfire_view>
             get_renderable_views_on_workspace(std::tuple<int, int> ws) = 0;
+        /* the same, but fills views and reuses its memory, for the renderer */
+        virtual void get_renderable_views_on_workspace(std::tuple<int, int> ws,
+                std::vector<wayfire_view>& views) = 0;
 
         /* wayfire_shell implementation */
         virtual void add_background(wayfire_view background, int x, int y) = 0;
@@ -126,11 +313,42 @@ class workspace_manager
         virtual weston_geometry get_workarea() = 0;
 };
 
+/* signal names are interned once, see signal_manager::get_signal_id() */
+using signal_id_t = uint32_t;
+
 struct signal_manager
 {
     private:
-        std::unordered_map<std::string, std::vector<signal_callback_t*>> sig;
+        struct connection_list
+        {
+            std::vector<signal_callback_t*> callbacks;
+            /* callbacks disconnected while the signal is being emitted are
+             * only set to null, and removed when the emission finishes */
+            int emitting = 0;
+            bool has_removed = false;
+        };
+
+        /* indexed by signal id */
+        std::vector<connection_list> sig;
+
     public:
+        /* returns the id of the signal with the given name,
+         * ids are the same for all outputs */
+        static signal_id_t get_signal_id(const std::string& name);
+
+        void connect_signal(signal_id_t id, signal_callback_t* callback);
+        void disconnect_signal(signal_id_t id, signal_callback_t* callback);
+        void emit_signal(signal_id_t id, signal_data *data);
+
+        /* typed versions, Signal is one of the descriptors from signal_definitions.hpp */
+        template<class Signal> void connect(signal_callback_t *callback)
+        { connect_signal(Signal::id(), callback); }
+        template<class Signal> void disconnect(signal_callback_t *callback)
+        { disconnect_signal(Signal::id(), callback); }
+        template<class Signal> void emit(typename Signal::data_type *data)
+        { emit_signal(Signal::id(), data); }
+
+        /* string versions, they have to look up the id on each call */
         void connect_signal(std::string name, signal_callback_t* callback);
         void disconnect_signal(std::string name, signal_callback_t* callback);
         void emit_signal(std::string name, signal_data *data);
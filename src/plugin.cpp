@@ -1,6 +1,7 @@
 #include "core.hpp"
 #include "output.hpp"
 #include <cmath>
+#include <algorithm>
 #include "input-manager.hpp"
 
 bool wayfire_grab_interface_t::grab()
@@ -51,3 +52,50 @@ float GetProgress(float start, float end, float current_step, float max_steps)
     float prog = std::sin(c * MPI);
     return prog * end + (1 - prog) * start;
 }
+
+float wf_easing::linear(float x)
+{
+    return x;
+}
+
+float wf_easing::sine_out(float x)
+{
+    return std::sin(x * MPI);
+}
+
+float wf_easing::cubic_in_out(float x)
+{
+    if (x < 0.5)
+        return 4 * x * x * x;
+
+    float y = 2 * x - 2;
+    return 1 + y * y * y / 2;
+}
+
+wf_duration::wf_duration(int length_ms, wf_easing_t easing)
+    : length_ms(length_ms), easing(easing) {}
+
+void wf_duration::start()
+{
+    start_time = wf_get_frame_time();
+}
+
+float wf_duration::progress()
+{
+    if (length_ms <= 0)
+        return 1;
+
+    float elapsed = (wf_get_frame_time() - start_time) / 1e6 / length_ms;
+    return easing(std::max(0.0f, std::min(1.0f, elapsed)));
+}
+
+float wf_duration::progress(float from, float to)
+{
+    float c = progress();
+    return c * to + (1 - c) * from;
+}
+
+bool wf_duration::running()
+{
+    return wf_get_frame_time() - start_time < length_ms * 1000000ll;
+}
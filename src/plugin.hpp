@@ -5,6 +5,7 @@
 #include <unordered_set>
 #include <functional>
 #include <memory>
+#include <cstdint>
 
 using std::string;
 
@@ -146,4 +147,38 @@ using render_hook_t = std::function<void()>;
                         auto y = std::get<1>(t)
 
 float GetProgress(float start, float end, float current_step, float max_steps);
+
+/* easing functions map the linear progress of an animation in [0, 1] */
+using wf_easing_t = float (*)(float);
+namespace wf_easing
+{
+    float linear(float x);
+    /* fast start and slow end, the curve of GetProgress() */
+    float sine_out(float x);
+    float cubic_in_out(float x);
+}
+
+/* the time(in ns on render_manager::frame_clock) when the frame which is
+ * being painted will be presented, or the current time outside of painting */
+int64_t wf_get_frame_time();
+
+/* An animation which lasts length_ms, regardless of the refresh rate.
+ * The progress is sampled at wf_get_frame_time(), so dropped frames make
+ * the animation skip ahead instead of stretching it */
+class wf_duration
+{
+    int length_ms;
+    wf_easing_t easing;
+    int64_t start_time = 0;
+
+    public:
+    wf_duration(int length_ms = 0, wf_easing_t easing = wf_easing::sine_out);
+
+    void start();
+    /* eased progress in [0, 1] */
+    float progress();
+    float progress(float from, float to);
+    /* false once length_ms have passed, progress() is 1 from then on */
+    bool running();
+};
 #endif
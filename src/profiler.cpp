@@ -0,0 +1,219 @@
+#include "profiler.hpp"
+#include "core.hpp"
+
+#include <vector>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+namespace profiler
+{
+    bool enabled = false;
+
+    struct hook_stats
+    {
+        uint64_t calls = 0;
+        double total_ms = 0, max_ms = 0;
+    };
+
+    struct owner_t
+    {
+        std::string name;
+        hook_stats stats[HOOK_KIND_COUNT];
+    };
+
+    static const char *kind_names[HOOK_KIND_COUNT] = {
+        "init", "renderer", "effect", "view_effect",
+        "frame", "signal", "binding", "grab"
+    };
+
+    /* owners are never freed, their stats outlive outputs and plugins */
+    static std::vector<owner_t*> owners;
+
+    struct hook_owner
+    {
+        owner_t *owner;
+        /* how many times the hook is registered */
+        size_t count;
+    };
+    static std::unordered_map<const void*, hook_owner> hook_owners;
+
+    /* for hooks registered outside of plugins */
+    static owner_t core_owner = {"core", {}};
+    static owner_t *current = nullptr;
+    static scope *current_scope = nullptr;
+
+    owner_t *create_owner()
+    {
+        if (!enabled)
+            return nullptr;
+
+        auto owner = new owner_t;
+        owner->name = "unnamed";
+        owners.push_back(owner);
+        return owner;
+    }
+
+    void set_owner_name(owner_t *owner, const std::string& name)
+    {
+        if (owner)
+            owner->name = name;
+    }
+
+    void set_hook_owner(const void *hook)
+    {
+        if (!enabled)
+            return;
+
+        /* the last registration decides, e.g for the renderer of an output */
+        auto& entry = hook_owners[hook];
+        entry.owner = current ? current : &core_owner;
+        ++entry.count;
+    }
+
+    void forget_hook(const void *hook)
+    {
+        if (!enabled)
+            return;
+
+        auto it = hook_owners.find(hook);
+        if (it != hook_owners.end() && --it->second.count == 0)
+            hook_owners.erase(it);
+    }
+
+    void scope::begin(owner_t *owner, hook_kind kind)
+    {
+        this->owner = owner;
+        this->kind = kind;
+
+        previous = current;
+        current = owner;
+
+        parent = current_scope;
+        current_scope = this;
+        start = std::chrono::steady_clock::now();
+    }
+
+    scope::scope(const void *hook, hook_kind kind)
+    {
+        if (!enabled)
+            return;
+
+        auto it = hook_owners.find(hook);
+        begin(it == hook_owners.end() ? &core_owner : it->second.owner, kind);
+    }
+
+    scope::scope(owner_t *owner, hook_kind kind)
+    {
+        if (enabled)
+            begin(owner ? owner : &core_owner, kind);
+    }
+
+    scope::~scope()
+    {
+        if (!owner)
+            return;
+
+        using ms_duration = std::chrono::duration<double, std::milli>;
+        double elapsed = ms_duration(std::chrono::steady_clock::now() - start).count();
+        double self = std::max(0.0, elapsed - children_ms);
+
+        auto& stats = owner->stats[kind];
+        ++stats.calls;
+        stats.total_ms += self;
+        stats.max_ms = std::max(stats.max_ms, self);
+
+        if (parent)
+            parent->children_ms += elapsed;
+
+        current = previous;
+        current_scope = parent;
+    }
+
+    struct report_entry
+    {
+        std::string owner;
+        int kind;
+        hook_stats stats;
+    };
+
+    /* the same plugin has an owner on each output, merge them by name */
+    static std::vector<report_entry> collect_report()
+    {
+        std::map<std::pair<std::string, int>, hook_stats> merged;
+
+        auto add_owner = [&] (owner_t *owner)
+        {
+            for (int i = 0; i < HOOK_KIND_COUNT; i++)
+            {
+                if (!owner->stats[i].calls)
+                    continue;
+
+                auto& entry = merged[{owner->name, i}];
+                entry.calls += owner->stats[i].calls;
+                entry.total_ms += owner->stats[i].total_ms;
+                entry.max_ms = std::max(entry.max_ms, owner->stats[i].max_ms);
+            }
+        };
+
+        add_owner(&core_owner);
+        for (auto owner : owners)
+            add_owner(owner);
+
+        std::vector<report_entry> report;
+        for (auto& entry : merged)
+            report.push_back({entry.first.first, entry.first.second, entry.second});
+
+        std::sort(report.begin(), report.end(),
+                [] (const report_entry& a, const report_entry& b)
+                {
+                    return a.stats.total_ms > b.stats.total_ms;
+                });
+
+        return report;
+    }
+
+    void write_report(std::ostream& out)
+    {
+        out << "profiler: plugin, hook, calls, self ms, average self ms, max self ms\n";
+        for (auto& entry : collect_report())
+        {
+            out << "profiler: " << entry.owner << ", " << kind_names[entry.kind]
+                << ", " << entry.stats.calls << ", " << entry.stats.total_ms
+                << ", " << entry.stats.total_ms / entry.stats.calls
+                << ", " << entry.stats.max_ms << "\n";
+        }
+    }
+
+    void write_prometheus(std::ostream& out)
+    {
+        if (!enabled)
+            return;
+
+        auto report = collect_report();
+        auto write_metric = [&] (const std::string& name, const std::string& type,
+                std::function<double(const hook_stats&)> value)
+        {
+            out << "# TYPE " << name << " " << type << "\n";
+            for (auto& entry : report)
+            {
+                out << name << "{plugin=\"" << entry.owner << "\",hook=\""
+                    << kind_names[entry.kind] << "\"} " << value(entry.stats) << "\n";
+            }
+        };
+
+        write_metric("wayfire_plugin_hook_calls_total", "counter",
+                [] (const hook_stats& s) { return s.calls; });
+        write_metric("wayfire_plugin_hook_self_seconds_total", "counter",
+                [] (const hook_stats& s) { return s.total_ms / 1000; });
+        write_metric("wayfire_plugin_hook_max_self_seconds", "gauge",
+                [] (const hook_stats& s) { return s.max_ms / 1000; });
+    }
+
+    void init()
+    {
+        enabled = true;
+        info << "profiler: enabled, send SIGUSR2 for a report" << std::endl;
+    }
+}
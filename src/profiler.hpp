@@ -0,0 +1,76 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <string>
+#include <ostream>
+#include <chrono>
+
+/* Accounts the time spent in plugin hooks to the plugins which own them.
+ * It is enabled with [core] profile = 1, and the report is dumped on SIGUSR2
+ * and included in the metrics socket.
+ *
+ * A hook(effect, renderer, signal callback, binding, grab interface) belongs
+ * to the plugin whose code registered it: either the plugin being initialized,
+ * or the owner of the hook which is running at the moment.
+ *
+ * The times are self times: hooks which run inside of another one, e.g a
+ * signal emitted by a renderer, are accounted only to their own owner */
+namespace profiler
+{
+    extern bool enabled;
+
+    enum hook_kind
+    {
+        HOOK_INIT,
+        HOOK_RENDERER,
+        HOOK_EFFECT,
+        HOOK_VIEW_EFFECT,
+        HOOK_FRAME,
+        HOOK_SIGNAL,
+        HOOK_BINDING,
+        HOOK_GRAB,
+        HOOK_KIND_COUNT
+    };
+
+    struct owner_t;
+
+    /* plugin_manager creates an owner for each plugin, and names it
+     * after init(), when the grab interface has a name */
+    owner_t *create_owner();
+    void set_owner_name(owner_t *owner, const std::string& name);
+
+    /* hook is any pointer which identifies the hook, e.g the std::function.
+     * The same hook can be registered more than once(e.g a callback for
+     * several signals), it is forgotten when all registrations are gone */
+    void set_hook_owner(const void *hook);
+    void forget_hook(const void *hook);
+
+    /* measures the time until it is destroyed, and makes the owner current,
+     * so that hooks registered in the meantime belong to it as well */
+    class scope
+    {
+        owner_t *owner = nullptr, *previous;
+        hook_kind kind;
+        std::chrono::steady_clock::time_point start;
+
+        /* the scope this one runs in, and the time of the scopes inside it */
+        scope *parent;
+        double children_ms = 0;
+
+        void begin(owner_t *owner, hook_kind kind);
+
+        public:
+        scope(const void *hook, hook_kind kind);
+        scope(owner_t *owner, hook_kind kind);
+        ~scope();
+    };
+
+    /* sorted by total time, human readable */
+    void write_report(std::ostream& out);
+    void write_prometheus(std::ostream& out);
+
+    /* start profiling, core dumps the report on SIGUSR2 */
+    void init();
+}
+
+#endif /* end of include guard: PROFILER_HPP */
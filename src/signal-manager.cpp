@@ -0,0 +1,100 @@
+/* signal_manager is kept apart from the rest of the output,
+ * so that wayfire-microbench can build it without libweston */
+#include "output.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+signal_id_t signal_manager::get_signal_id(const std::string& name)
+{
+    static std::unordered_map<std::string, signal_id_t> ids;
+
+    auto it = ids.find(name);
+    if (it != ids.end())
+        return it->second;
+
+    signal_id_t id = ids.size();
+    ids[name] = id;
+    return id;
+}
+
+void signal_manager::connect_signal(signal_id_t id, signal_callback_t* callback)
+{
+    if (id >= sig.size())
+        sig.resize(id + 1);
+
+    sig[id].callbacks.push_back(callback);
+    profiler::set_hook_owner(callback);
+}
+
+void signal_manager::disconnect_signal(signal_id_t id, signal_callback_t* callback)
+{
+    if (id >= sig.size())
+        return;
+
+    profiler::forget_hook(callback);
+
+    auto& list = sig[id];
+    if (list.emitting)
+    {
+        for (auto& cb : list.callbacks)
+        {
+            if (cb == callback)
+            {
+                cb = nullptr;
+                list.has_removed = true;
+            }
+        }
+
+        return;
+    }
+
+    auto it = std::remove(list.callbacks.begin(), list.callbacks.end(), callback);
+    list.callbacks.erase(it, list.callbacks.end());
+}
+
+void signal_manager::emit_signal(signal_id_t id, signal_data *data)
+{
+    if (id >= sig.size())
+        return;
+
+    /* callbacks may connect or disconnect signals, so we can't keep references
+     * to the lists. Callbacks connected during the emission aren't called */
+    sig[id].emitting++;
+
+    size_t count = sig[id].callbacks.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        auto callback = sig[id].callbacks[i];
+        if (callback)
+        {
+            profiler::scope scope(callback, profiler::HOOK_SIGNAL);
+            (*callback)(data);
+        }
+    }
+
+    auto& list = sig[id];
+    if (--list.emitting == 0 && list.has_removed)
+    {
+        auto it = std::remove(list.callbacks.begin(), list.callbacks.end(), nullptr);
+        list.callbacks.erase(it, list.callbacks.end());
+        list.has_removed = false;
+    }
+}
+
+void signal_manager::connect_signal(std::string name, signal_callback_t* callback)
+{
+    connect_signal(get_signal_id(name), callback);
+}
+
+void signal_manager::disconnect_signal(std::string name, signal_callback_t* callback)
+{
+    disconnect_signal(get_signal_id(name), callback);
+}
+
+void signal_manager::emit_signal(std::string name, signal_data *data)
+{
+    emit_signal(get_signal_id(name), data);
+}
+
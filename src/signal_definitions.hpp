@@ -75,5 +75,47 @@ struct reserved_workarea_signal : public signal_data
     uint32_t height;
 };
 
-#endif
+/* sent by an output after each frame, durations are in microseconds */
+struct frame_done_signal : public signal_data
+{
+    int64_t paint_time;
+    bool missed_deadline;
+};
+
+/* Descriptors for the signals emitted by core, for use with the typed
+ * signal_manager API, e.g output->signal->emit<wf_signal::focus_view>(&data).
+ * The signal id is interned the first time it is used */
+#define DECLARE_WF_SIGNAL(descriptor, signal_name, type) \
+    struct descriptor \
+    { \
+        using data_type = type; \
+        static signal_id_t id() \
+        { \
+            static signal_id_t signal_id = signal_manager::get_signal_id(signal_name); \
+            return signal_id; \
+        } \
+    }
+
+namespace wf_signal
+{
+    DECLARE_WF_SIGNAL(create_view,             "create-view",             create_view_signal);
+    DECLARE_WF_SIGNAL(destroy_view,            "destroy-view",            destroy_view_signal);
+    DECLARE_WF_SIGNAL(attach_view,             "attach-view",             create_view_signal);
+    DECLARE_WF_SIGNAL(detach_view,             "detach-view",             destroy_view_signal);
+    DECLARE_WF_SIGNAL(focus_view,              "focus-view",              focus_view_signal);
+    DECLARE_WF_SIGNAL(view_maximized_request,  "view-maximized-request",  view_maximized_signal);
+    DECLARE_WF_SIGNAL(view_fullscreen_request, "view-fullscreen-request", view_fullscreen_signal);
+    DECLARE_WF_SIGNAL(view_set_parent,         "view-set-parent",         view_set_parent_signal);
+    DECLARE_WF_SIGNAL(move_request,            "move-request",            move_request_signal);
+    DECLARE_WF_SIGNAL(resize_request,          "resize-request",          resize_request_signal);
+    DECLARE_WF_SIGNAL(viewport_changed,        "viewport-changed",        change_viewport_signal);
+    DECLARE_WF_SIGNAL(reserved_workarea,       "reserved-workarea",       reserved_workarea_signal);
+    DECLARE_WF_SIGNAL(output_resized,          "output-resized",          signal_data);
+    DECLARE_WF_SIGNAL(output_gain_focus,       "output-gain-focus",       signal_data);
+    DECLARE_WF_SIGNAL(reload_gl,               "reload-gl",               signal_data);
+    DECLARE_WF_SIGNAL(wake,                    "wake",                    signal_data);
+    DECLARE_WF_SIGNAL(sleep,                   "sleep",                   signal_data);
+    DECLARE_WF_SIGNAL(frame_done,              "frame-done",              frame_done_signal);
+}
 
+#endif
@@ -0,0 +1,139 @@
+#include "tracing.hpp"
+#include "commonincludes.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace tracing
+{
+    bool enabled = false;
+    static std::string trace_file;
+
+    struct event
+    {
+        const char *name;
+        char phase;
+        int64_t ts, dur, arg;
+    };
+
+    /* 64k events, about 2.5MB per thread */
+    static const uint64_t ring_size = 1 << 16;
+
+    struct ring_buffer
+    {
+        pid_t tid;
+        /* only the owning thread writes, flush() reads up to head */
+        std::atomic<uint64_t> head;
+        event events[ring_size];
+    };
+
+    /* rings are never freed, so that events of finished threads can be flushed */
+    static std::mutex rings_mutex;
+    static std::vector<ring_buffer*> rings;
+    static thread_local ring_buffer *thread_ring = nullptr;
+
+    static ring_buffer *get_thread_ring()
+    {
+        if (!thread_ring)
+        {
+            thread_ring = new ring_buffer;
+            thread_ring->tid = syscall(SYS_gettid);
+            thread_ring->head = 0;
+
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.push_back(thread_ring);
+        }
+
+        return thread_ring;
+    }
+
+    static void record(const char *name, char phase, int64_t ts, int64_t dur, int64_t arg)
+    {
+        auto ring = get_thread_ring();
+        uint64_t pos = ring->head.load(std::memory_order_relaxed);
+
+        ring->events[pos % ring_size] = {name, phase, ts, dur, arg};
+        ring->head.store(pos + 1, std::memory_order_release);
+    }
+
+    int64_t now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+    }
+
+    void complete(const char *name, int64_t start, int64_t duration, int64_t arg)
+    {
+        if (enabled)
+            record(name, 'X', start, duration, arg);
+    }
+
+    void instant(const char *name, int64_t arg)
+    {
+        if (enabled)
+            record(name, 'i', now(), 0, arg);
+    }
+
+    void init(std::string file)
+    {
+        trace_file = file;
+        enabled = true;
+
+        info << "tracing: enabled, send SIGUSR2 to write " << file << std::endl;
+    }
+
+    void flush()
+    {
+        if (!enabled)
+            return;
+
+        std::ofstream out(trace_file);
+        if (!out.is_open())
+        {
+            errio << "tracing: can't open " << trace_file << std::endl;
+            return;
+        }
+
+        out << "{\"traceEvents\":[\n";
+
+        bool first = true;
+        pid_t pid = getpid();
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (auto ring : rings)
+        {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t begin = head > ring_size ? head - ring_size : 0;
+
+            for (uint64_t i = begin; i < head; i++)
+            {
+                const auto& ev = ring->events[i % ring_size];
+
+                out << (first ? "" : ",\n") << "{\"name\":\"" << ev.name
+                    << "\",\"cat\":\"wayfire\",\"ph\":\"" << ev.phase
+                    << "\",\"ts\":" << ev.ts << ",\"pid\":" << pid
+                    << ",\"tid\":" << ring->tid;
+
+                if (ev.phase == 'X')
+                    out << ",\"dur\":" << ev.dur;
+                else
+                    out << ",\"s\":\"t\"";
+
+                if (ev.arg >= 0)
+                    out << ",\"args\":{\"id\":" << ev.arg << "}";
+
+                out << "}";
+                first = false;
+            }
+        }
+
+        out << "\n]}\n";
+        info << "tracing: wrote " << trace_file << std::endl;
+    }
+}
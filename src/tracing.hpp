@@ -0,0 +1,49 @@
+#ifndef TRACING_HPP
+#define TRACING_HPP
+
+#include <string>
+#include <cstdint>
+
+/* Records the frame lifecycle in the Chrome trace event format, which can be
+ * opened in chrome://tracing or Perfetto. It is enabled with [core] trace_file,
+ * and the file is (re)written on SIGUSR2 with the events still in the buffers.
+ *
+ * Every thread writes to its own ring buffer without locking, so the oldest
+ * events are overwritten. Names must be string literals */
+namespace tracing
+{
+    extern bool enabled;
+
+    /* microseconds on the monotonic clock */
+    int64_t now();
+
+    /* arg is shown in the event's details if it isn't negative, usually an output id */
+    void complete(const char *name, int64_t start, int64_t duration, int64_t arg = -1);
+    void instant(const char *name, int64_t arg = -1);
+
+    /* records a complete event from its construction to its destruction */
+    class span
+    {
+        const char *name;
+        int64_t arg;
+        int64_t start = -1;
+
+        public:
+        span(const char *name, int64_t arg = -1) : name(name), arg(arg)
+        {
+            if (enabled)
+                start = now();
+        }
+
+        ~span()
+        {
+            if (start >= 0)
+                complete(name, start, now() - start, arg);
+        }
+    };
+
+    void init(std::string file);
+    void flush();
+}
+
+#endif /* end of include guard: TRACING_HPP */
@@ -0,0 +1,138 @@
+/* Which parts of which views have to be redrawn in a frame of the output or
+ * of a workspace stream. Kept apart from the rest of the render_manager, so
+ * that wayfire-microbench can build it without libweston */
+#include "opengl.hpp"
+#include "output.hpp"
+#include "view.hpp"
+
+render_manager::damaged_view& render_manager::next_damaged_view()
+{
+    auto& scratch = frame_scratch;
+    if (scratch.damaged_views_count == scratch.damaged_views.size())
+    {
+        /* pixman regions can be moved around, so we don't care if the vector reallocates */
+        scratch.damaged_views.push_back({});
+        pixman_region32_init(&scratch.damaged_views.back().damage);
+    }
+
+    return scratch.damaged_views[scratch.damaged_views_count++];
+}
+
+/* whether the view isn't rendered where libweston thinks it is,
+ * so its opaque region and damage are of no use in screen space */
+static bool view_transformed(wayfire_view view)
+{
+    const glm::mat4 identity;
+    auto& tr = view->transform;
+
+    return tr.rotation != identity || tr.scale != identity ||
+        tr.translation != identity ||
+        wayfire_view_transform::global_rotation != identity ||
+        wayfire_view_transform::global_scale != identity ||
+        wayfire_view_transform::global_translate != identity;
+}
+
+/* whether the view hides everything below its opaque region */
+static bool view_occludes(wayfire_view view)
+{
+    if (view->is_hidden)
+        return false;
+
+    return view->transform.color[3] == 1.0f && !view_transformed(view);
+}
+
+void render_manager::transformation_renderer()
+{
+    auto& views = frame_scratch.views;
+    output->workspace->get_renderable_views_on_workspace(
+            output->workspace->get_current_workspace(), views);
+
+    /* scissored to the repaint region in paint() */
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+
+    /* walk the views from top to bottom and find which part of each view
+     * isn't covered by the opaque views above it */
+    auto& visible = frame_scratch.visible;
+    pixman_region32_copy(&visible, &repaint_region);
+
+    frame_scratch.damaged_views_count = 0;
+    for (auto& view : views)
+    {
+        if (!pixman_region32_not_empty(&visible))
+            break;
+
+        if (view->is_hidden) /* use is_visible() when implemented */
+            continue;
+
+        auto& dv = next_damaged_view();
+        dv.view = view;
+
+        /* the opaque regions above are in screen space, but a transformed
+         * view is rendered somewhere else, so it can't be clipped by them */
+        if (view_transformed(view))
+            pixman_region32_copy(&dv.damage, &repaint_region);
+        else
+            pixman_region32_copy(&dv.damage, &visible);
+
+        if (view_occludes(dv.view))
+            pixman_region32_subtract(&visible, &visible, &view->handle->transform.opaque);
+    }
+
+    for (int i = (int)frame_scratch.damaged_views_count - 1; i >= 0; i--)
+    {
+        auto& dv = frame_scratch.damaged_views[i];
+        dv.view->render(0, &dv.damage);
+    }
+
+    frame_scratch.damaged_views_count = 0;
+}
+
+void render_manager::collect_damaged_views(std::tuple<int, int> ws,
+        pixman_region32_t *damage, int dx, int dy)
+{
+    auto g = output->get_full_geometry();
+
+    auto& views = frame_scratch.views;
+    output->workspace->get_renderable_views_on_workspace(ws, views);
+
+    /* streams are updated one after another, so they can share the scratch lists */
+    frame_scratch.damaged_views_count = 0;
+
+    auto it = views.begin();
+    while (it != views.end() && pixman_region32_not_empty(damage))
+    {
+        auto view = *it;
+        ++it;
+
+        if (!view->is_visible())
+            continue;
+
+        auto& dv = next_damaged_view();
+        dv.view = view;
+
+        if (view->is_special)
+        {
+            /* make background's damage be at the target viewport */
+            pixman_region32_intersect_rect(&dv.damage, damage,
+                view->geometry.x - view->ds_geometry.x + (dx - g.x),
+                view->geometry.y - view->ds_geometry.y + (dy - g.y),
+                view->surface->width, view->surface->height);
+        } else
+        {
+            pixman_region32_intersect_rect(&dv.damage, damage,
+                    view->geometry.x - view->ds_geometry.x,
+                    view->geometry.y - view->ds_geometry.y,
+                    view->surface->width, view->surface->height);
+        }
+
+        if (pixman_region32_not_empty(&dv.damage)) {
+            /* If we are processing background, then this is not correct, as its
+             * transform.opaque isn't positioned properly. But as
+             * background is the last in the list, we don' care */
+            pixman_region32_subtract(damage, damage, &view->handle->transform.opaque);
+        } else {
+            /* give the entry back */
+            --frame_scratch.damaged_views_count;
+        }
+    };
+}
@@ -2,7 +2,9 @@
 #include "opengl.hpp"
 #include "output.hpp"
 #include <glm/glm.hpp>
+#include <algorithm>
 #include "signal_definitions.hpp"
+#include "profiler.hpp"
 
 #include <xwayland-api.h>
 #include <libweston-desktop.h>
@@ -75,6 +77,7 @@ wayfire_view_t::wayfire_view_t(weston_desktop_surface *ds)
 
     desktop_surface = ds;
     ds_geometry = {0, 0, 0, 0};
+    geometry.x = geometry.y = 0;
     surface = weston_desktop_surface_get_surface(ds);
 
     geometry.width = surface->width;
@@ -105,14 +108,41 @@ void wayfire_view_t::move(int x, int y)
 {
     geometry.x = x;
     geometry.y = y;
-    weston_view_set_position(handle, x - ds_geometry.x,
-            y - ds_geometry.y);
+    position_dirty = true;
+    sync_position();
+
+    notify_geometry_changed();
+}
+
+void wayfire_view_t::move_lazy(int x, int y)
+{
+    geometry.x = x;
+    geometry.y = y;
+    position_dirty = true;
+
+    notify_geometry_changed();
+}
+
+void wayfire_view_t::sync_position()
+{
+    if (!position_dirty)
+        return;
+
+    position_dirty = false;
+    weston_view_set_position(handle, geometry.x - ds_geometry.x,
+            geometry.y - ds_geometry.y);
 
     /* TODO: we should check if surface is wayland/xwayland in the beginning, since
      * this won't change, it doesn't make sense to check this every time */
     if (xwayland_surface_api && xwayland_surface_api->is_xwayland_surface(surface))
-        xwayland_surface_api->send_position(surface, x - ds_geometry.x,
-                y - ds_geometry.y);
+        xwayland_surface_api->send_position(surface, geometry.x - ds_geometry.x,
+                geometry.y - ds_geometry.y);
+}
+
+void wayfire_view_t::notify_geometry_changed()
+{
+    if (output && output->workspace)
+        output->workspace->view_geometry_changed(core->find_view(handle));
 }
 
 void wayfire_view_t::resize(int w, int h)
@@ -142,6 +172,9 @@ void wayfire_view_t::set_fullscreen(bool full)
 {
     fullscreen = full;
     weston_desktop_surface_set_fullscreen(desktop_surface, fullscreen);
+
+    /* the workspace manager keeps count of fullscreen views */
+    notify_geometry_changed();
 }
 
 void wayfire_view_t::map(int sx, int sy)
@@ -187,7 +220,7 @@ void wayfire_view_t::map(int sx, int sy)
         is_mapped = true;
 
         auto sig_data = create_view_signal{core->find_view(handle)};
-        output->signal->emit_signal("create-view", &sig_data);
+        output->signal->emit<wf_signal::create_view>(&sig_data);
 
         if (!is_special)
             output->focus_view(core->find_view(handle), core->get_current_seat());
@@ -201,8 +234,12 @@ void wayfire_view_t::map(int sx, int sy)
         move(geometry.x, geometry.y);
     }
 
-    geometry.width = new_ds_g.width;
-    geometry.height = new_ds_g.height;
+    if (geometry.width != new_ds_g.width || geometry.height != new_ds_g.height)
+    {
+        geometry.width = new_ds_g.width;
+        geometry.height = new_ds_g.height;
+        notify_geometry_changed();
+    }
 
     auto full  = weston_desktop_surface_get_fullscreen(desktop_surface),
          maxim = weston_desktop_surface_get_maximized(desktop_surface);
@@ -212,7 +249,7 @@ void wayfire_view_t::map(int sx, int sy)
         view_fullscreen_signal data;
         data.view = core->find_view(handle);
         data.state = full;
-        output->signal->emit_signal("view-fullscreen-request", &data);
+        output->signal->emit<wf_signal::view_fullscreen_request>(&data);
 
         set_fullscreen(full);
     } else if (maxim != maximized)
@@ -221,13 +258,19 @@ void wayfire_view_t::map(int sx, int sy)
         data.view = core->find_view(handle);
         data.state = maximized;
 
-        output->signal->emit_signal("view-maximized-request", &data);
+        output->signal->emit<wf_signal::view_maximized_request>(&data);
         set_maximized(maximized);
     }
 }
 
+struct surface_scratch
+{
+    pixman_region32_t *damage;
+    std::vector<OpenGL::texture_quad> *quads;
+};
+
 static void render_surface(weston_surface *surface, pixman_region32_t *damage,
-        int x, int y, glm::mat4, glm::vec4, uint32_t bits);
+        int x, int y, glm::mat4, glm::vec4, uint32_t bits, surface_scratch scratch);
 
 /* TODO: use bits */
 void wayfire_view_t::simple_render(uint32_t bits, pixman_region32_t *damage)
@@ -245,9 +288,11 @@ void wayfire_view_t::simple_render(uint32_t bits, pixman_region32_t *damage)
 
     pixman_region32_translate(damage, -og.x, -og.y);
 
+    auto& frame_scratch = output->render->frame_scratch;
     render_surface(surface, damage,
             geometry.x - ds_geometry.x - og.x, geometry.y - ds_geometry.y - og.y,
-            transform.calculate_total_transform(), transform.color, bits);
+            transform.calculate_total_transform(), transform.color, bits,
+            {&frame_scratch.surface_damage, &frame_scratch.quads});
 
     pixman_region32_translate(damage, og.x, og.y);
 
@@ -259,40 +304,58 @@ void wayfire_view_t::render(uint32_t bits, pixman_region32_t *damage)
 {
     simple_render(bits, damage);
 
-    std::vector<effect_hook_t*> hooks_to_run;
-    for (auto hook : effects)
-        hooks_to_run.push_back(hook);
+    if (effects.empty())
+        return;
+
+    /* hooks can remove themselves, so run a snapshot of the list.
+     * Views rarely have more than a few effects, so keep it on the stack */
+    const size_t max_stack_hooks = 8;
+    effect_hook_t *stack_hooks[max_stack_hooks];
+    std::vector<effect_hook_t*> heap_hooks;
+
+    effect_hook_t **hooks_to_run = stack_hooks;
+    size_t count = effects.size();
+    if (count > max_stack_hooks)
+    {
+        heap_hooks = effects;
+        hooks_to_run = heap_hooks.data();
+    } else
+    {
+        std::copy(effects.begin(), effects.end(), stack_hooks);
+    }
 
-    for (auto hook : hooks_to_run)
-        (*hook)();
+    for (size_t i = 0; i < count; i++)
+    {
+        profiler::scope scope(hooks_to_run[i], profiler::HOOK_VIEW_EFFECT);
+        (*hooks_to_run[i])();
+    }
 }
 
-static inline void render_surface_box(GLuint tex[3], int n_tex, const pixman_box32_t& surface_box,
-        const pixman_box32_t& subbox, glm::mat4 transform,
-        glm::vec4 color, uint32_t bits)
+static inline OpenGL::texture_quad get_surface_box_quad(const pixman_box32_t& surface_box,
+        const pixman_box32_t& subbox)
 {
-    OpenGL::texture_geometry texg = {
+    OpenGL::texture_quad quad;
+    quad.texg = {
         1.0f * (subbox.x1 - surface_box.x1) / (surface_box.x2 - surface_box.x1),
         1.0f * (subbox.y1 - surface_box.y1) / (surface_box.y2 - surface_box.y1),
         1.0f * (subbox.x2 - surface_box.x1) / (surface_box.x2 - surface_box.x1),
         1.0f * (subbox.y2 - surface_box.y1) / (surface_box.y2 - surface_box.y1),
     };
 
-    weston_geometry geometry =
+    quad.geometry =
     {
         subbox.x1, subbox.y1,
         subbox.x2 - subbox.x1, subbox.y2 - subbox.y1
     };
 
-    OpenGL::use_default_program();
-    for (int i = 0; i < n_tex; i++) {
-        OpenGL::render_transformed_texture(tex[i], geometry, texg, transform,
-                                           color, bits);
-    }
+    return quad;
 }
 
+/* scratch is owned by the output, so that we don't allocate on every frame.
+ * It isn't needed anymore when we recurse into the subsurfaces */
 static void render_surface(weston_surface *surface, pixman_region32_t *damage,
-        int x, int y, glm::mat4 transform, glm::vec4 color, uint32_t bits)
+        int x, int y, glm::mat4 transform, glm::vec4 color, uint32_t bits,
+        surface_scratch scratch)
 {
     if (!surface->is_mapped || !surface->renderer_state ||
             surface->width * surface->height == 0)
@@ -301,26 +364,30 @@ static void render_surface(weston_surface *surface, pixman_region32_t *damage,
     if (!render_manager::renderer_api)
 	return;
 
-    pixman_region32_t damaged_region;
-    pixman_region32_init_rect(&damaged_region, x, y,
+    auto damaged_region = scratch.damage;
+    pixman_region32_intersect_rect(damaged_region, damage, x, y,
             surface->width, surface->height);
-    pixman_region32_intersect(&damaged_region, &damaged_region, damage);
 
     pixman_box32_t surface_box;
     surface_box.x1 = x; surface_box.y1 = y;
     surface_box.x2 = x + surface->width; surface_box.y2 = y + surface->height;
 
     int n = 0;
-    pixman_box32_t *boxes = pixman_region32_rectangles(&damaged_region, &n);
+    pixman_box32_t *boxes = pixman_region32_rectangles(damaged_region, &n);
 
     int n_tex;
     GLuint *tex = (GLuint*)render_manager::renderer_api->surface_get_textures(surface, &n_tex);
 
-    for (int i = 0; i < n; i++) {
-        render_surface_box(tex, n_tex, surface_box, boxes[i],
+    /* all damaged boxes of a texture are rendered with a single draw call */
+    auto& quads = *scratch.quads;
+    quads.clear();
+    for (int i = 0; i < n; i++)
+        quads.push_back(get_surface_box_quad(surface_box, boxes[i]));
+
+    for (int i = 0; i < n_tex; i++) {
+        OpenGL::render_transformed_texture_quads(tex[i], quads.data(), quads.size(),
                 transform, color, bits | TEXTURE_USE_TEX_GEOMETRY);
     }
-    pixman_region32_fini(&damaged_region);
 
     weston_subsurface *sub;
     if (!wl_list_empty(&surface->subsurface_list)) {
@@ -328,7 +395,7 @@ static void render_surface(weston_surface *surface, pixman_region32_t *damage,
             if (sub && sub->surface != surface) {
                 render_surface(sub->surface, damage,
                         sub->position.x + x, sub->position.y + y,
-                        transform, color, bits);
+                        transform, color, bits, scratch);
             }
         }
     }
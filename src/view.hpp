@@ -31,6 +31,9 @@ class wayfire_view_transform {
 
 /* effect hooks are called after main rendering */
 using effect_hook_t = std::function<void()>;
+/* frame hooks are called before rendering with the predicted time
+ * when the frame will be presented, see render_manager::add_frame_hook() */
+using frame_hook_t = std::function<void(const timespec&)>;
 class wayfire_output;
 
 struct wayfire_point {
@@ -50,6 +53,10 @@ struct wf_custom_view_data
 
 class wayfire_view_t
 {
+        /* let the workspace manager know the view has been moved/resized
+         * or its fullscreen state has changed */
+        void notify_geometry_changed();
+
     public:
         weston_desktop_surface *desktop_surface, *parent_surface = nullptr;
         weston_surface *surface;
@@ -74,6 +81,12 @@ class wayfire_view_t
         } xwayland;
 
         void move(int x, int y);
+        /* update only the geometry, libweston and xwayland will
+         * be notified about the new position on sync_position() */
+        void move_lazy(int x, int y);
+        void sync_position();
+        bool position_dirty = false;
+
         void resize(int w, int h);
         void set_geometry(weston_geometry g);
         /* convenience function */
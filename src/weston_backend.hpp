@@ -7,6 +7,7 @@
 #include <compositor-drm.h>
 #include <compositor-x11.h>
 #include <compositor-wayland.h>
+#include <compositor-headless.h>
 #include <windowed-output-api.h>
 #include <cstring>
 #include <assert.h>
@@ -235,4 +236,47 @@ int load_x11_backend(weston_compositor *ec)
     return 0;
 }
 
+/* the headless backend has no input devices, plugins(e.g bench) and
+ * input replay send input through this seat with notify_key() and co. */
+static weston_seat headless_seat;
+
+/* libweston-3's headless backend has no GL support, so it uses the pixman
+ * renderer, and wayfire runs without renderers and effects */
+int load_headless_backend(weston_compositor *ec)
+{
+    weston_headless_backend_config config;
+    std::memset(&config, 0, sizeof(config));
+
+    config.base.struct_version = WESTON_HEADLESS_BACKEND_CONFIG_VERSION;
+    config.base.struct_size = sizeof(weston_headless_backend_config);
+    config.use_pixman = true;
+
+    if (weston_compositor_load_backend(ec, WESTON_BACKEND_HEADLESS, &config.base) < 0)
+        return -1;
+
+    core->backend = WESTON_BACKEND_HEADLESS;
+    set_output_pending_handler(ec, configure_windowed_output);
+
+    auto api = weston_windowed_output_get_api(ec);
+    if (api == NULL)
+        return -1;
+
+    /* configured in [headless-1], [headless-2] etc. */
+    int outputs = device_config::config->get_section("core")->get_int("headless_outputs", 1);
+    for (int i = 1; i <= outputs; i++)
+    {
+        auto name = "headless-" + std::to_string(i);
+        if (api->output_create(ec, name.c_str()) < 0)
+            return -1;
+    }
+
+    weston_seat_init(&headless_seat, ec, "headless");
+    weston_seat_init_pointer(&headless_seat);
+    weston_seat_init_touch(&headless_seat);
+    if (weston_seat_init_keyboard(&headless_seat, NULL) < 0)
+        return -1;
+
+    return 0;
+}
+
 #endif /* end of include guard: WESTON_BACKEND_HPP */